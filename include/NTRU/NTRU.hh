@@ -5,9 +5,15 @@
 #include "NTRU/NTRU_Poly.hh"
 #include "NTRU/NTRU_Keys.hh"
 #include "NTRU/NTRU_Util.hh"
+#include "NTRU/NTRU_Tune.hh"
+#include "NTRU/NTRU_Trace.hh"
+#include "NTRU/NTRU_Blind.hh"
 
 #include <cstdlib>
+#include <string>
 #include <tuple>
+#include <type_traits>
+#include <vector>
 
 namespace ntru
 {
@@ -17,13 +23,21 @@ namespace ntru
         srand(seed);
     }
 
+    inline bool NTRU_Init(unsigned int seed, std::string const& profile)
+    {
+        srand(seed);
+        return NTRU_LoadPlans(profile);
+    }
+
     template <typename Tp>
     inline NTRU_Basis<Tp> NTRU_GenBasis(NTRU_Seed<Tp> const& seed)
     {
+        NTRU_StageTimer const timer{NTRU_Stage::Rejection};
         NTRU_Basis<Tp> basis;
 
         do
         {
+            NTRU_StageTimer const timer{NTRU_Stage::Trinomial};
             basis = { NTRU_GenTrinomial<Tp>(seed.N,seed.d+1,seed.d), NTRU_GenTrinomial<Tp>(seed.N,seed.d,seed.d) };
         }
         while (not NTRU_IsValid(seed,basis));
@@ -34,33 +48,262 @@ namespace ntru
     template <typename Tp>
     inline NTRU_KeyPair<Tp> NTRU_GenKeys(NTRU_Seed<Tp> const& seed, NTRU_Basis<Tp> const& basis)
     {
-        auto const poly_Fp = NTRU_GetInverse(seed.N,seed.p,basis.poly_f);
-        auto const poly_Fq = NTRU_GetInverse(seed.N,seed.q,basis.poly_f);
-        auto const poly_h = NTRU_Reduce(seed.N,seed.q,poly_Fq*basis.poly_g);
+        auto const plan = NTRU_GetPlan(seed);
+
+        Poly<Tp> poly_Fp, poly_Fq;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::InverseP};
+            poly_Fp = NTRU_GetInverse(plan,seed.N,seed.p,basis.poly_f);
+        }
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::InverseQ};
+            poly_Fq = NTRU_GetInverse(plan,seed.N,seed.q,basis.poly_f);
+        }
+        auto const poly_h = NTRU_Convolve(plan,seed.N,seed.q,poly_Fq,basis.poly_g);
 
         auto const key_pub = NTRU_PubKey<Tp>{ seed, poly_h };
         auto const key_prv = NTRU_PrvKey<Tp>{ seed, basis.poly_f, poly_Fp };
         return { key_pub, key_prv };
     }
 
+    template <typename Tp>
+    inline NTRU_ProductBasis<Tp> NTRU_GenBasis(NTRU_ProductSeed<Tp> const& seed)
+    {
+        NTRU_StageTimer const timer{NTRU_Stage::Rejection};
+        NTRU_ProductBasis<Tp> basis;
+
+        do
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Trinomial};
+            basis = {
+                NTRU_GenTrinomial<Tp>(seed.seed.N,seed.d1,seed.d1),
+                NTRU_GenTrinomial<Tp>(seed.seed.N,seed.d2,seed.d2),
+                NTRU_GenTrinomial<Tp>(seed.seed.N,seed.d3,seed.d3),
+                NTRU_GenTrinomial<Tp>(seed.seed.N,seed.seed.d,seed.seed.d)
+            };
+        }
+        while (not NTRU_IsValid(seed,basis));
+
+        return basis;
+    }
+
+    template <typename Tp>
+    inline NTRU_ProductKeyPair<Tp> NTRU_GenKeys(NTRU_ProductSeed<Tp> const& seed, NTRU_ProductBasis<Tp> const& basis)
+    {
+        auto const& base = seed.seed;
+        auto const plan = NTRU_GetPlan(base);
+
+        Poly<Tp> poly_Fq;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::InverseQ};
+            poly_Fq = NTRU_GetInverse(plan,base.N,base.q,NTRU_GetProductPoly(base,basis));
+        }
+        auto const poly_h = NTRU_Convolve(plan,base.N,base.q,poly_Fq,basis.poly_g);
+
+        auto const key_pub = NTRU_PubKey<Tp>{ base, poly_h };
+        auto const key_prv = NTRU_ProductPrvKey<Tp>{
+            base, NTRU_GetSparse(basis.poly_f1), NTRU_GetSparse(basis.poly_f2), NTRU_GetSparse(basis.poly_f3)
+        };
+        return { key_pub, key_prv };
+    }
+
+    template <typename Tp>
+    inline std::vector<NTRU_KeyPair<Tp>> NTRU_GenKeysBatch(NTRU_Seed<Tp> const& seed, size_t count)
+    {
+        auto const plan = NTRU_GetPlan(seed);
+
+        std::vector<NTRU_KeyPair<Tp>> keypairs;
+        keypairs.reserve(count);
+
+        while (keypairs.size() < count)
+        {
+            std::vector<NTRU_Basis<Tp>> bases(count - keypairs.size());
+            std::vector<Poly<Tp>> polys_f;
+            polys_f.reserve(bases.size());
+
+            for (auto& basis : bases)
+            {
+                NTRU_StageTimer const timer{NTRU_Stage::Trinomial};
+                basis = { NTRU_GenTrinomial<Tp>(seed.N,seed.d+1,seed.d), NTRU_GenTrinomial<Tp>(seed.N,seed.d,seed.d) };
+                polys_f.push_back(basis.poly_f);
+            }
+
+            std::vector<Poly<Tp>> polys_Fp, polys_Fq;
+            {
+                NTRU_StageTimer const timer{NTRU_Stage::InverseP};
+                polys_Fp = NTRU_GetInverseBatch(plan,seed.N,seed.p,polys_f);
+            }
+            {
+                NTRU_StageTimer const timer{NTRU_Stage::InverseQ};
+                polys_Fq = NTRU_GetInverseBatch(plan,seed.N,seed.q,polys_f);
+            }
+
+            for (size_t i = 0; i < bases.size(); ++i)
+            {
+                if (polys_Fp[i].size() == 0 || polys_Fq[i].size() == 0) continue;
+
+                auto const poly_h = NTRU_Convolve(plan,seed.N,seed.q,polys_Fq[i],bases[i].poly_g);
+                keypairs.push_back({ { seed, poly_h }, { seed, bases[i].poly_f, polys_Fp[i] } });
+            }
+        }
+        return keypairs;
+    }
+
+    /*
+     * NTRU_Convolve with the multiplication and the reduction traced as
+     * separate stages. The lazy kernel fuses the two and is traced as a
+     * convolution only.
+     */
+    template <typename Tp>
+    inline Poly<Tp> NTRU_ConvolveTraced(NTRU_Plan const& plan, size_t degree, Tp const& modulo,
+        Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        if (plan.reduce == NTRU_ReduceKernel::Lazy)
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            return NTRU_ConvolveLazy(degree,modulo,poly1,poly2);
+        }
+
+        Poly<NTRU_Accum<Tp,Tp>> product;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            product = NTRU_Multiply(plan,poly1,poly2);
+        }
+        NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+        return NTRU_Reduce(plan,degree,modulo,product);
+    }
+
     template <typename Tp>
     inline Poly<Tp> NTRU_Encrypt(NTRU_PubKey<Tp> const& key_pub, Poly<Tp> const& message)
     {
-        auto const poly_r = NTRU_GenTrinomial<Tp>(key_pub.seed.N,key_pub.seed.d,key_pub.seed.d);
+        auto const& seed = key_pub.seed;
+        auto const plan = NTRU_GetPlan(seed);
+
+        Poly<Tp> poly_r;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Trinomial};
+            poly_r = NTRU_GenTrinomial<Tp>(seed.N,seed.d,seed.d);
+        }
+
+        if (plan.reduce == NTRU_ReduceKernel::Lazy)
+        {
+            Poly<Tp> poly_e;
+            {
+                NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+                poly_e = NTRU_ConvolveLazy(seed.N,seed.q,seed.p * key_pub.poly_h,poly_r) + message;
+            }
+            NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+            return NTRU_Reduce(seed.N,seed.q,poly_e);
+        }
 
-        auto const poly_e = key_pub.seed.p * key_pub.poly_h * poly_r + message;
-        return NTRU_Reduce(key_pub.seed.N,key_pub.seed.q,poly_e);
+        // The message is added before the reduction so e is reduced once
+        Poly<NTRU_Accum<Tp,Tp>> product;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            product = NTRU_Multiply(plan,seed.p * key_pub.poly_h,poly_r) + NTRU_Cast<NTRU_Accum<Tp,Tp>>(message);
+        }
+        NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+        return NTRU_Reduce(plan,seed.N,seed.q,product);
     }
 
     template <typename Tp>
     inline Poly<Tp> NTRU_Decrypt(NTRU_PrvKey<Tp> const& key_prv, Poly<Tp> const& message)
     {
-        auto poly_a = key_prv.poly_f * message;
-        poly_a = NTRU_Reduce(key_prv.seed.N,key_prv.seed.q,poly_a);
-        poly_a = NTRU_CenterLift(key_prv.seed.q,poly_a);
+        auto const& seed = key_prv.seed;
+        auto const plan = NTRU_GetPlan(seed);
+
+        auto poly_a = NTRU_ConvolveTraced(plan,seed.N,seed.q,key_prv.poly_f,message);
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::CenterLift};
+            poly_a = NTRU_CenterLift(seed.q,poly_a);
+        }
+        return NTRU_ConvolveTraced(plan,seed.N,seed.p,key_prv.poly_Fp,poly_a);
+    }
+
+    template <typename Tp, typename Ts>
+    inline Poly<Tp> NTRU_Encrypt(NTRU_PubContext<Tp,Ts> const& context, Poly<Tp> const& message)
+    {
+        auto const& seed = context.seed;
+
+        Poly<Tp> poly_r, poly_e;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Trinomial};
+            poly_r = NTRU_GenTrinomial<Tp>(seed.N,seed.d,seed.d);
+        }
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            if constexpr (std::is_same_v<Ts,Tp>) {
+                poly_e = NTRU_SparseConvolve(seed.N,seed.q,NTRU_GetSparse(poly_r),context.poly_ph) + message;
+            } else {
+                auto const poly_pr = NTRU_ConvolveLazy<Ts>(seed.N,seed.q,context.poly_ph,NTRU_Cast<int8_t>(poly_r));
+                poly_e = NTRU_Cast<Tp>(poly_pr) + message;
+            }
+        }
+        NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+        return NTRU_Reduce(seed.N,seed.q,poly_e);
+    }
+
+    template <typename Tp>
+    inline Poly<Tp> NTRU_Encrypt(NTRU_BlindPool<Tp>& pool, Poly<Tp> const& message)
+    {
+        auto const poly_e = pool.blind() + message;
+
+        NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+        return NTRU_Reduce(pool.context().seed.N,pool.context().seed.q,poly_e);
+    }
+
+    template <typename Tp, typename Ts>
+    inline Poly<Tp> NTRU_Decrypt(NTRU_PrvContext<Tp,Ts> const& context, Poly<Tp> const& message)
+    {
+        auto const& seed = context.seed;
+
+        Poly<Tp> poly_a;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            poly_a = NTRU_SparseConvolve(seed.N,seed.q,context.sparse_f,message);
+        }
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::CenterLift};
+            poly_a = NTRU_CenterLift(seed.q,poly_a);
+        }
+
+        if constexpr (std::is_same_v<Ts,Tp>) {
+            return NTRU_ConvolveTraced(NTRU_GetPlan(seed),seed.N,seed.p,context.poly_Fp,poly_a);
+        } else {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            return NTRU_ConvolveLazy(seed.N,seed.p,context.poly_Fp,poly_a);
+        }
+    }
+
+    /*
+     * With f = 1 + p*(f1*f2 + f3), f*e is e + p*(f1*(f2*e) + f3*e): three
+     * sparse convolutions. Since f is 1 mod p there is no Fp to multiply by,
+     * the message is the center-lifted result reduced mod p.
+     */
+    template <typename Tp>
+    inline Poly<Tp> NTRU_Decrypt(NTRU_ProductPrvKey<Tp> const& key_prv, Poly<Tp> const& message)
+    {
+        auto const& seed = key_prv.seed;
+
+        Poly<Tp> poly_a;
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Convolve};
+            auto const poly_b = NTRU_SparseConvolve(seed.N,seed.q,key_prv.sparse_f2,message);
+            auto const poly_c = NTRU_SparseConvolve(seed.N,seed.q,key_prv.sparse_f1,poly_b)
+                + NTRU_SparseConvolve(seed.N,seed.q,key_prv.sparse_f3,message);
+            poly_a = message + seed.p * poly_c;
+        }
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+            poly_a = NTRU_Reduce(seed.N,seed.q,poly_a);
+        }
+        {
+            NTRU_StageTimer const timer{NTRU_Stage::CenterLift};
+            poly_a = NTRU_CenterLift(seed.q,poly_a);
+        }
 
-        auto poly_b = key_prv.poly_Fp * poly_a;
-        return NTRU_Reduce(key_prv.seed.N,key_prv.seed.p,poly_b);
+        NTRU_StageTimer const timer{NTRU_Stage::Reduce};
+        return NTRU_Reduce(seed.N,seed.p,poly_a);
     }
 
 } // namespace ntru
@@ -0,0 +1,284 @@
+
+#ifndef __HH_NTRU_BLIND
+#define __HH_NTRU_BLIND
+
+#include "NTRU_Keys.hh"
+#include "NTRU_Poly.hh"
+#include "NTRU_Util.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <semaphore>
+#include <thread>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definition
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    /*
+     * A bounded lock-free multi-producer multi-consumer ring buffer, after
+     * Vyukov. Every cell carries a sequence number telling producers and
+     * consumers whose turn it is, so neither side ever takes a lock.
+     */
+    template <typename Tp>
+    class NTRU_RingBuffer
+    {
+    public:
+        explicit NTRU_RingBuffer(size_t capacity);
+
+        NTRU_RingBuffer(NTRU_RingBuffer const&) = delete;
+        NTRU_RingBuffer& operator=(NTRU_RingBuffer const&) = delete;
+
+    public:
+        bool push(Tp&&);
+        bool pop(Tp&);
+
+        auto capacity() const -> size_t { return m_Mask + 1; }
+        auto size() const -> size_t;
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence{0};
+            Tp data{};
+        };
+
+    private:
+        size_t m_Mask;
+        std::unique_ptr<Cell[]> m_Cells;
+        alignas(64) std::atomic<size_t> m_Head{0};
+        alignas(64) std::atomic<size_t> m_Tail{0};
+    };
+
+    struct NTRU_BlindStats
+    {
+        uint64_t hits, misses;
+        size_t size, target;
+    };
+
+    /*
+     * Keeps a ring of precomputed blinding polynomials p*h*r for one public key,
+     * refilled by a background thread, so the online part of encryption is a
+     * pop, an addition and a reduction mod q. The fill target adapts to load:
+     * it doubles whenever a consumer finds the ring empty, and decays while no
+     * blinds are being taken at all.
+     */
+    template <typename Tp>
+    class NTRU_BlindPool
+    {
+    public:
+        explicit NTRU_BlindPool(NTRU_PubKey<Tp> const& key_pub, size_t capacity = 64);
+        virtual ~NTRU_BlindPool();
+
+        NTRU_BlindPool(NTRU_BlindPool const&) = delete;
+        NTRU_BlindPool& operator=(NTRU_BlindPool const&) = delete;
+
+    public:
+        auto blind() -> Poly<Tp>;
+        auto stats() const -> NTRU_BlindStats;
+
+        auto context() const -> NTRU_PubContext<Tp> const& { return m_Context; }
+
+    private:
+        template <typename Engine>
+        auto generate(Engine&) const -> Poly<Tp>;
+        void work();
+        void wake();
+
+    private:
+        NTRU_PubContext<Tp> m_Context;
+        NTRU_RingBuffer<Poly<Tp>> m_Ring;
+
+        std::atomic<size_t> m_Target;
+        std::atomic<uint64_t> m_Hits{0}, m_Misses{0};
+
+        std::atomic<bool> m_Running{true};
+        std::atomic<bool> m_Refill{false};
+        std::binary_semaphore m_Signal{0};
+        std::thread m_Thread{};
+    };
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    template <typename Tp>
+    NTRU_RingBuffer<Tp>::NTRU_RingBuffer(size_t capacity)
+        : m_Mask{std::bit_ceil(std::max<size_t>(capacity,2)) - 1}
+        , m_Cells{new Cell[m_Mask+1]}
+    {
+        for (size_t i = 0; i <= m_Mask; ++i)
+        {
+            m_Cells[i].sequence.store(i,std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Tp>
+    bool NTRU_RingBuffer<Tp>::push(Tp&& value)
+    {
+        auto position = m_Tail.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            auto& cell = m_Cells[position & m_Mask];
+            auto const sequence = cell.sequence.load(std::memory_order_acquire);
+            auto const delta = (intptr_t)sequence - (intptr_t)position;
+
+            if (delta == 0)
+            {
+                if (m_Tail.compare_exchange_weak(position,position+1,std::memory_order_relaxed))
+                {
+                    cell.data = std::move(value);
+                    cell.sequence.store(position+1,std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (delta < 0) return false;
+            else position = m_Tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Tp>
+    bool NTRU_RingBuffer<Tp>::pop(Tp& value)
+    {
+        auto position = m_Head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            auto& cell = m_Cells[position & m_Mask];
+            auto const sequence = cell.sequence.load(std::memory_order_acquire);
+            auto const delta = (intptr_t)sequence - (intptr_t)(position+1);
+
+            if (delta == 0)
+            {
+                if (m_Head.compare_exchange_weak(position,position+1,std::memory_order_relaxed))
+                {
+                    value = std::move(cell.data);
+                    cell.sequence.store(position+m_Mask+1,std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (delta < 0) return false;
+            else position = m_Head.load(std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Tp>
+    size_t NTRU_RingBuffer<Tp>::size() const
+    {
+        auto const head = m_Head.load(std::memory_order_relaxed);
+        auto const tail = m_Tail.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    template <typename Tp>
+    NTRU_BlindPool<Tp>::NTRU_BlindPool(NTRU_PubKey<Tp> const& key_pub, size_t capacity)
+        : m_Context{NTRU_GetContext(key_pub)}
+        , m_Ring{capacity}
+        , m_Target{std::max<size_t>(m_Ring.capacity()/4,1)}
+    {
+        m_Thread = std::thread{[this]() { work(); }};
+    }
+
+    template <typename Tp>
+    NTRU_BlindPool<Tp>::~NTRU_BlindPool()
+    {
+        m_Running.store(false);
+        wake();
+        m_Thread.join();
+    }
+
+    template <typename Tp>
+    template <typename Engine>
+    Poly<Tp> NTRU_BlindPool<Tp>::generate(Engine& engine) const
+    {
+        auto const& seed = m_Context.seed;
+        auto const poly_r = NTRU_GenTrinomial<Tp>(seed.N,seed.d,seed.d,engine);
+        return NTRU_SparseConvolve(seed.N,seed.q,NTRU_GetSparse(poly_r),m_Context.poly_ph);
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_BlindPool<Tp>::blind()
+    {
+        Poly<Tp> result;
+
+        if (m_Ring.pop(result))
+        {
+            m_Hits.fetch_add(1,std::memory_order_relaxed);
+            if (m_Ring.size() < m_Target.load(std::memory_order_relaxed) / 2) wake();
+            return result;
+        }
+
+        m_Misses.fetch_add(1,std::memory_order_relaxed);
+        auto target = m_Target.load(std::memory_order_relaxed);
+        while (target < m_Ring.capacity() && not m_Target.compare_exchange_weak(target,
+            std::min(2*target,m_Ring.capacity()),std::memory_order_relaxed));
+        wake();
+
+        thread_local std::mt19937_64 engine = NTRU_GetEngine();
+        return generate(engine);
+    }
+
+    template <typename Tp>
+    NTRU_BlindStats NTRU_BlindPool<Tp>::stats() const
+    {
+        return {
+            m_Hits.load(std::memory_order_relaxed),
+            m_Misses.load(std::memory_order_relaxed),
+            m_Ring.size(),
+            m_Target.load(std::memory_order_relaxed)
+        };
+    }
+
+    /*
+     * Only the caller that raises the refill flag releases the semaphore, and
+     * the worker lowers the flag only after acquiring it, so the count never
+     * exceeds one and a burst of consumers signals the worker just once.
+     */
+    template <typename Tp>
+    void NTRU_BlindPool<Tp>::wake()
+    {
+        if (not m_Refill.exchange(true,std::memory_order_acq_rel)) m_Signal.release();
+    }
+
+    template <typename Tp>
+    void NTRU_BlindPool<Tp>::work()
+    {
+        auto engine = NTRU_GetEngine();
+
+        while (m_Running.load())
+        {
+            if (m_Ring.size() < m_Target.load(std::memory_order_relaxed))
+            {
+                m_Ring.push(generate(engine));
+                continue;
+            }
+
+            auto const hits = m_Hits.load(std::memory_order_relaxed);
+            bool const woken = m_Signal.try_acquire_for(std::chrono::milliseconds(100));
+            if (woken) m_Refill.store(false,std::memory_order_release);
+
+            if (not woken && hits == m_Hits.load(std::memory_order_relaxed))
+            {
+                auto const target = m_Target.load(std::memory_order_relaxed);
+                m_Target.store(std::max<size_t>(target - target / 8,1),std::memory_order_relaxed);
+            }
+        }
+    }
+
+} // namespace ntru
+
+#endif // __HH_NTRU_BLIND
@@ -0,0 +1,327 @@
+
+#ifndef __HH_NTRU_CACHE
+#define __HH_NTRU_CACHE
+
+#include "NTRU_Hazard.hh"
+#include "NTRU_Keys.hh"
+#include "NTRU_Poly.hh"
+#include "NTRU_Util.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definition
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    struct NTRU_CacheStats
+    {
+        uint64_t hits, misses, evictions;
+        size_t entries, bytes;
+    };
+
+    /*
+     * A sharded, size-bounded cache of precomputed key contexts.
+     *
+     * Each shard publishes an immutable table through an atomic raw pointer,
+     * guarded by NTRU_Hazard, so a lookup that hits never takes a lock; it
+     * only bumps the entry's access tick and the shard's own counters. Misses build the context outside the lock, then copy-on-write
+     * the shard table, evicting the least recently used entries until the
+     * shard fits in its share of the byte budget. Replaced tables are freed
+     * once no hazard pointer refers to them.
+     */
+    template <typename Key, typename Context>
+    class NTRU_ContextCache
+    {
+    public:
+        explicit NTRU_ContextCache(size_t max_bytes, size_t shard_count = 16);
+        virtual ~NTRU_ContextCache();
+
+        NTRU_ContextCache(NTRU_ContextCache const&) = delete;
+        NTRU_ContextCache& operator=(NTRU_ContextCache const&) = delete;
+
+    public:
+        auto get(Key const&) -> std::shared_ptr<Context const>;
+        auto stats() const -> NTRU_CacheStats;
+        void clear();
+
+    private:
+        struct Entry
+        {
+            Key key;
+            std::shared_ptr<Context const> context;
+            size_t bytes;
+            mutable std::atomic<uint64_t> tick;
+        };
+        using Table = std::unordered_map<uint64_t,std::shared_ptr<Entry const>>;
+
+        struct alignas(64) Shard
+        {
+            std::atomic<Table const*> table{new Table{}};
+            std::atomic<size_t> bytes{0};
+            std::mutex mutex{};
+            std::vector<Table const*> retired{};
+
+            alignas(64) std::atomic<uint64_t> clock{0};
+            std::atomic<uint64_t> hits{0}, misses{0}, evictions{0};
+        };
+
+        static_assert(std::atomic<Table const*>::is_always_lock_free);
+
+        auto shard(uint64_t fingerprint) -> Shard& { return m_Shards[fingerprint % m_Shards.size()]; }
+
+        using Hazard = NTRU_Hazard<NTRU_ContextCache>;
+        static void publish(Shard&, Table const*);
+
+    private:
+        size_t m_ShardBytes;
+        std::vector<Shard> m_Shards;
+    };
+
+    template <typename Tp, typename Ts = Tp>
+    using NTRU_PubCache = NTRU_ContextCache<NTRU_PubKey<Tp>,NTRU_PubContext<Tp,Ts>>;
+
+    template <typename Tp, typename Ts = Tp>
+    using NTRU_PrvCache = NTRU_ContextCache<NTRU_PrvKey<Tp>,NTRU_PrvContext<Tp,Ts>>;
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Key Extensions
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    template <typename Tp>
+    uint64_t NTRU_Fingerprint(NTRU_Seed<Tp> const& seed, Poly<Tp> const& poly)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto const mix = [&hash](uint64_t value)
+        {
+            hash = (hash ^ value) * 0x100000001b3ull;
+        };
+
+        mix(seed.N); mix(seed.d);
+        mix((uint64_t)seed.p); mix((uint64_t)seed.q);
+        if (poly.size() == 0) return hash;
+        for (size_t i = 0; i <= poly.order(); ++i) mix((uint64_t)poly.coeffs()[i]);
+        return hash;
+    }
+
+    template <typename Tp>
+    uint64_t NTRU_Fingerprint(NTRU_PubKey<Tp> const& key_pub)
+    {
+        return NTRU_Fingerprint(key_pub.seed,key_pub.poly_h);
+    }
+
+    template <typename Tp>
+    uint64_t NTRU_Fingerprint(NTRU_PrvKey<Tp> const& key_prv)
+    {
+        return NTRU_Fingerprint(key_prv.seed,key_prv.poly_f);
+    }
+
+    /*
+     * Compares coefficient storage directly, treating missing coefficients as
+     * zero. Poly's operator== pads the shorter operand through operator[],
+     * which would write to an entry other threads are reading.
+     */
+    template <typename Tp>
+    bool NTRU_IsSame(Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        auto const& coeffs1 = poly1.coeffs();
+        auto const& coeffs2 = poly2.coeffs();
+
+        for (size_t i = 0; i < std::max(coeffs1.size(),coeffs2.size()); ++i)
+        {
+            auto const coeff1 = i < coeffs1.size() ? coeffs1[i] : Tp{};
+            auto const coeff2 = i < coeffs2.size() ? coeffs2[i] : Tp{};
+            if (coeff1 != coeff2) return false;
+        }
+        return true;
+    }
+
+    template <typename Tp>
+    bool NTRU_IsSame(NTRU_Seed<Tp> const& seed1, NTRU_Seed<Tp> const& seed2)
+    {
+        return seed1.N == seed2.N && seed1.d == seed2.d && seed1.p == seed2.p && seed1.q == seed2.q;
+    }
+
+    template <typename Tp>
+    bool NTRU_IsSame(NTRU_PubKey<Tp> const& key1, NTRU_PubKey<Tp> const& key2)
+    {
+        return NTRU_IsSame(key1.seed,key2.seed) && NTRU_IsSame(key1.poly_h,key2.poly_h);
+    }
+
+    template <typename Tp>
+    bool NTRU_IsSame(NTRU_PrvKey<Tp> const& key1, NTRU_PrvKey<Tp> const& key2)
+    {
+        return NTRU_IsSame(key1.seed,key2.seed)
+            && NTRU_IsSame(key1.poly_f,key2.poly_f) && NTRU_IsSame(key1.poly_Fp,key2.poly_Fp);
+    }
+
+    template <typename Tp, typename Ts>
+    size_t NTRU_SizeOf(NTRU_PubKey<Tp> const& key_pub, NTRU_PubContext<Tp,Ts> const& context)
+    {
+        return sizeof(key_pub) + sizeof(context)
+            + sizeof(Tp) * key_pub.poly_h.coeffs().capacity()
+            + sizeof(Ts) * context.poly_ph.coeffs().capacity();
+    }
+
+    template <typename Tp, typename Ts>
+    size_t NTRU_SizeOf(NTRU_PrvKey<Tp> const& key_prv, NTRU_PrvContext<Tp,Ts> const& context)
+    {
+        return sizeof(key_prv) + sizeof(context)
+            + sizeof(Tp) * (key_prv.poly_f.coeffs().capacity() + key_prv.poly_Fp.coeffs().capacity())
+            + sizeof(Ts) * context.poly_Fp.coeffs().capacity()
+            + sizeof(size_t) * (context.sparse_f.index_pos.capacity() + context.sparse_f.index_neg.capacity());
+    }
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    template <typename Key, typename Context>
+    NTRU_ContextCache<Key,Context>::NTRU_ContextCache(size_t max_bytes, size_t shard_count)
+        : m_ShardBytes{max_bytes / std::max<size_t>(shard_count,1)}
+        , m_Shards(std::max<size_t>(shard_count,1))
+    {
+    }
+
+    template <typename Key, typename Context>
+    NTRU_ContextCache<Key,Context>::~NTRU_ContextCache()
+    {
+        for (auto& shard : m_Shards)
+        {
+            delete shard.table.load();
+            for (auto const table : shard.retired) delete table;
+        }
+    }
+
+    /*
+     * Swaps in a new shard table and frees every replaced table that no reader
+     * still holds. Must be called with the shard mutex held.
+     */
+    template <typename Key, typename Context>
+    void NTRU_ContextCache<Key,Context>::publish(Shard& shard, Table const* table)
+    {
+        shard.retired.push_back(shard.table.exchange(table,std::memory_order_seq_cst));
+        Hazard::reclaim(shard.retired);
+    }
+
+    template <typename Key, typename Context>
+    auto NTRU_ContextCache<Key,Context>::get(Key const& key) -> std::shared_ptr<Context const>
+    {
+        auto const fingerprint = NTRU_Fingerprint(key);
+        auto& shard = this->shard(fingerprint);
+        {
+            auto const table = Hazard::acquire(shard.table);
+            auto const iter = table->find(fingerprint);
+
+            if (iter != table->end() && NTRU_IsSame(iter->second->key,key))
+            {
+                iter->second->tick.store(shard.clock.fetch_add(1,std::memory_order_relaxed),std::memory_order_relaxed);
+                shard.hits.fetch_add(1,std::memory_order_relaxed);
+
+                auto context = iter->second->context;
+                Hazard::release();
+                return context;
+            }
+            Hazard::release();
+        }
+        shard.misses.fetch_add(1,std::memory_order_relaxed);
+
+        auto const context = std::make_shared<Context const>(NTRU_GetContext<typename Context::Storage>(key));
+        auto const bytes = sizeof(Entry) + NTRU_SizeOf(key,*context);
+        if (bytes > m_ShardBytes) return context;
+
+        std::lock_guard<std::mutex> const lock{shard.mutex};
+        auto table = std::make_unique<Table>(*shard.table.load(std::memory_order_acquire));
+        auto shard_bytes = shard.bytes.load(std::memory_order_relaxed);
+
+        if (auto const iter = table->find(fingerprint); iter != table->end())
+        {
+            shard_bytes -= iter->second->bytes;
+            table->erase(iter);
+        }
+        while (shard_bytes + bytes > m_ShardBytes && not table->empty())
+        {
+            auto const victim = std::min_element(table->begin(),table->end(),[](auto const& lhs, auto const& rhs)
+            {
+                return lhs.second->tick.load(std::memory_order_relaxed) < rhs.second->tick.load(std::memory_order_relaxed);
+            });
+            shard_bytes -= victim->second->bytes;
+            table->erase(victim);
+            shard.evictions.fetch_add(1,std::memory_order_relaxed);
+        }
+
+        auto const tick = shard.clock.fetch_add(1,std::memory_order_relaxed);
+        table->emplace(fingerprint,std::shared_ptr<Entry const>{new Entry{key,context,bytes,tick}});
+
+        shard.bytes.store(shard_bytes + bytes,std::memory_order_relaxed);
+        publish(shard,table.release());
+        return context;
+    }
+
+    template <typename Key, typename Context>
+    auto NTRU_ContextCache<Key,Context>::stats() const -> NTRU_CacheStats
+    {
+        NTRU_CacheStats result { 0, 0, 0, 0, 0 };
+
+        for (auto const& shard : m_Shards)
+        {
+            result.hits += shard.hits.load(std::memory_order_relaxed);
+            result.misses += shard.misses.load(std::memory_order_relaxed);
+            result.evictions += shard.evictions.load(std::memory_order_relaxed);
+            result.entries += Hazard::acquire(shard.table)->size();
+            result.bytes += shard.bytes.load(std::memory_order_relaxed);
+            Hazard::release();
+        }
+        return result;
+    }
+
+    template <typename Key, typename Context>
+    void NTRU_ContextCache<Key,Context>::clear()
+    {
+        for (auto& shard : m_Shards)
+        {
+            std::lock_guard<std::mutex> const lock{shard.mutex};
+            shard.bytes.store(0,std::memory_order_relaxed);
+            publish(shard,new Table{});
+        }
+    }
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Standard Extensions
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include <iosfwd>
+
+namespace std
+{
+
+    template <typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_CacheStats const& stats)
+    {
+        return ost << '{' << stats.hits << ',' << stats.misses << ',' << stats.evictions
+            << ',' << stats.entries << ',' << stats.bytes << '}';
+    }
+
+} // namespace std
+
+#endif // __HH_NTRU_CACHE
@@ -0,0 +1,142 @@
+
+#ifndef __HH_NTRU_HAZARD
+#define __HH_NTRU_HAZARD
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definition
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    /*
+     * Hazard pointers for structures published through an atomic raw pointer.
+     * Every thread owns one slot per `Domain`: a reader publishes the object it
+     * is about to use there, and a writer only frees a replaced object once no
+     * slot names it. A slot is unregistered when its thread exits, so the scan
+     * a writer performs is bounded by the number of live threads.
+     */
+    template <typename Domain>
+    class NTRU_Hazard
+    {
+    public:
+        template <typename Tp>
+        static auto acquire(std::atomic<Tp const*> const&) -> Tp const*;
+        static void release();
+
+        template <typename Tp>
+        static void reclaim(std::vector<Tp const*>& retired);
+
+    private:
+        struct Registry
+        {
+            std::mutex mutex{};
+            std::vector<std::atomic<void const*>*> slots{};
+        };
+
+        struct Slot
+        {
+            Slot();
+            ~Slot();
+
+            std::atomic<void const*> pointer{nullptr};
+        };
+
+        static auto registry() -> Registry&;
+        static auto slot() -> std::atomic<void const*>&;
+    };
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    template <typename Domain>
+    NTRU_Hazard<Domain>::Slot::Slot()
+    {
+        auto& registry = NTRU_Hazard::registry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+        registry.slots.push_back(&pointer);
+    }
+
+    template <typename Domain>
+    NTRU_Hazard<Domain>::Slot::~Slot()
+    {
+        auto& registry = NTRU_Hazard::registry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+        std::erase(registry.slots,&pointer);
+    }
+
+    template <typename Domain>
+    auto NTRU_Hazard<Domain>::registry() -> Registry&
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    template <typename Domain>
+    auto NTRU_Hazard<Domain>::slot() -> std::atomic<void const*>&
+    {
+        thread_local Slot slot;
+        return slot.pointer;
+    }
+
+    template <typename Domain>
+    template <typename Tp>
+    auto NTRU_Hazard<Domain>::acquire(std::atomic<Tp const*> const& source) -> Tp const*
+    {
+        auto& hazard = slot();
+        auto pointer = source.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            hazard.store(pointer,std::memory_order_seq_cst);
+            auto const current = source.load(std::memory_order_seq_cst);
+            if (current == pointer) return pointer;
+            pointer = current;
+        }
+    }
+
+    template <typename Domain>
+    void NTRU_Hazard<Domain>::release()
+    {
+        slot().store(nullptr,std::memory_order_release);
+    }
+
+    /*
+     * Frees every retired object no slot names, keeping the rest for a later
+     * pass. Objects must be unpublished before they are retired.
+     */
+    template <typename Domain>
+    template <typename Tp>
+    void NTRU_Hazard<Domain>::reclaim(std::vector<Tp const*>& retired)
+    {
+        std::vector<void const*> hazards;
+        {
+            auto& registry = NTRU_Hazard::registry();
+            std::lock_guard<std::mutex> const lock{registry.mutex};
+
+            hazards.reserve(registry.slots.size());
+            for (auto const hazard : registry.slots) hazards.push_back(hazard->load(std::memory_order_seq_cst));
+        }
+
+        std::erase_if(retired,[&hazards](Tp const* pointer)
+        {
+            if (std::find(hazards.begin(),hazards.end(),pointer) != hazards.end()) return false;
+            delete pointer;
+            return true;
+        });
+    }
+
+} // namespace ntru
+
+#endif // __HH_NTRU_HAZARD
@@ -45,6 +45,59 @@ namespace ntru
         NTRU_PrvKey<Tp> key_prv;
     };
 
+    struct NTRU_SparsePoly
+    {
+        std::vector<size_t> index_pos, index_neg;
+    };
+
+    template <typename Tp>
+    struct NTRU_ProductSeed
+    {
+        NTRU_Seed<Tp> seed;
+        size_t d1, d2, d3;
+    };
+
+    template <typename Tp>
+    struct NTRU_ProductBasis
+    {
+        Poly<Tp> poly_f1, poly_f2, poly_f3, poly_g;
+    };
+
+    template <typename Tp>
+    struct NTRU_ProductPrvKey
+    {
+        NTRU_Seed<Tp> seed;
+        NTRU_SparsePoly sparse_f1, sparse_f2, sparse_f3;
+    };
+
+    template <typename Tp>
+    struct NTRU_ProductKeyPair
+    {
+        NTRU_PubKey<Tp> key_pub;
+        NTRU_ProductPrvKey<Tp> key_prv;
+    };
+
+    /*
+     * Contexts may store their precomputed polynomial in a narrower type than
+     * the key, e.g. uint16_t for p*h mod q or int8_t for Fp mod p.
+     */
+    template <typename Tp, typename Ts = Tp>
+    struct NTRU_PubContext
+    {
+        using Storage = Ts;
+        NTRU_Seed<Tp> seed;
+        Poly<Ts> poly_ph;
+    };
+
+    template <typename Tp, typename Ts = Tp>
+    struct NTRU_PrvContext
+    {
+        using Storage = Ts;
+        NTRU_Seed<Tp> seed;
+        NTRU_SparsePoly sparse_f;
+        Poly<Ts> poly_Fp;
+    };
+
 } // namespace ntru
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -68,6 +121,18 @@ namespace std
         return ost << '{' << basis.poly_f << "," << basis.poly_g << '}';
     }
 
+    template <typename Tp, typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_ProductSeed<Tp> const& seed)
+    {
+        return ost << '{' << seed.seed << ',' << seed.d1 << ',' << seed.d2 << ',' << seed.d3 << '}';
+    }
+
+    template <typename Tp, typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_ProductBasis<Tp> const& basis)
+    {
+        return ost << '{' << basis.poly_f1 << "," << basis.poly_f2 << "," << basis.poly_f3 << "," << basis.poly_g << '}';
+    }
+
 } // namespace std
 
 #endif // __HH_NTRU
@@ -0,0 +1,264 @@
+
+#ifndef __HH_NTRU_PLAN
+#define __HH_NTRU_PLAN
+
+#include "NTRU_Hazard.hh"
+#include "NTRU_Keys.hh"
+
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definitions
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    enum class NTRU_MulKernel
+    {
+        Schoolbook, Sparse, Karatsuba, Parallel
+    };
+
+    enum class NTRU_ReduceKernel
+    {
+        Eager, Fold, Lazy
+    };
+
+    struct NTRU_Plan
+    {
+        NTRU_MulKernel mul = NTRU_MulKernel::Schoolbook;
+        NTRU_ReduceKernel reduce = NTRU_ReduceKernel::Eager;
+        size_t cutoff = 32;
+        size_t grain = 256;
+
+        bool operator==(NTRU_Plan const&) const = default;
+    };
+
+    /*
+     * Plans are looked up by the full parameter set rather than by N alone:
+     * two seeds sharing a degree can differ in weight and modulus, which
+     * moves the sparse and Karatsuba crossovers.
+     */
+    struct NTRU_PlanKey
+    {
+        size_t N, d;
+        long long p, q;
+
+        auto operator<=>(NTRU_PlanKey const&) const = default;
+    };
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    using NTRU_PlanTable = std::map<NTRU_PlanKey,NTRU_Plan>;
+
+    /*
+     * The table is copy-on-write and published through an atomic raw pointer,
+     * the same way the context cache publishes its shards, so a lookup on the
+     * encrypt path is a hazard-protected load with no lock or refcount.
+     */
+    struct NTRU_PlanRegistry
+    {
+        ~NTRU_PlanRegistry()
+        {
+            delete table.load();
+            for (auto const retired_table : retired) delete retired_table;
+        }
+
+        std::atomic<NTRU_PlanTable const*> table{new NTRU_PlanTable{}};
+        std::mutex mutex{};
+        std::vector<NTRU_PlanTable const*> retired{};
+    };
+
+    using NTRU_PlanHazard = NTRU_Hazard<NTRU_PlanTable>;
+
+    inline NTRU_PlanRegistry& NTRU_GetPlanRegistry()
+    {
+        static NTRU_PlanRegistry registry;
+        return registry;
+    }
+
+    template <typename Tp>
+    NTRU_PlanKey NTRU_GetPlanKey(NTRU_Seed<Tp> const& seed)
+    {
+        return { seed.N, seed.d, (long long)seed.p, (long long)seed.q };
+    }
+
+    inline NTRU_Plan NTRU_GetPlan(NTRU_PlanKey const& key)
+    {
+        auto const table = NTRU_PlanHazard::acquire(NTRU_GetPlanRegistry().table);
+        auto const iter = table->find(key);
+        auto const plan = iter != table->end() ? iter->second : NTRU_Plan{};
+        NTRU_PlanHazard::release();
+        return plan;
+    }
+
+    template <typename Tp>
+    NTRU_Plan NTRU_GetPlan(NTRU_Seed<Tp> const& seed)
+    {
+        return NTRU_GetPlan(NTRU_GetPlanKey(seed));
+    }
+
+    /*
+     * Swaps in a new table and frees every replaced table that no reader still
+     * holds. Must be called with the registry mutex held.
+     */
+    inline void NTRU_PublishPlans(NTRU_PlanRegistry& registry, NTRU_PlanTable const* table)
+    {
+        registry.retired.push_back(registry.table.exchange(table,std::memory_order_seq_cst));
+        NTRU_PlanHazard::reclaim(registry.retired);
+    }
+
+    inline void NTRU_SetPlans(NTRU_PlanTable const& plans)
+    {
+        auto& registry = NTRU_GetPlanRegistry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+
+        auto table = new NTRU_PlanTable{*registry.table.load(std::memory_order_acquire)};
+        for (auto const& [key,plan] : plans) (*table)[key] = plan;
+        NTRU_PublishPlans(registry,table);
+    }
+
+    inline void NTRU_SetPlan(NTRU_PlanKey const& key, NTRU_Plan const& plan)
+    {
+        NTRU_SetPlans({ { key, plan } });
+    }
+
+    template <typename Tp>
+    void NTRU_SetPlan(NTRU_Seed<Tp> const& seed, NTRU_Plan const& plan)
+    {
+        NTRU_SetPlan(NTRU_GetPlanKey(seed),plan);
+    }
+
+    inline void NTRU_ClearPlans()
+    {
+        auto& registry = NTRU_GetPlanRegistry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+        NTRU_PublishPlans(registry,new NTRU_PlanTable{});
+    }
+
+    inline char const* NTRU_GetName(NTRU_MulKernel kernel)
+    {
+        switch (kernel)
+        {
+            case NTRU_MulKernel::Schoolbook: return "schoolbook";
+            case NTRU_MulKernel::Sparse:     return "sparse";
+            case NTRU_MulKernel::Karatsuba:  return "karatsuba";
+            case NTRU_MulKernel::Parallel:   return "parallel";
+        }
+        return "";
+    }
+
+    inline char const* NTRU_GetName(NTRU_ReduceKernel kernel)
+    {
+        switch (kernel)
+        {
+            case NTRU_ReduceKernel::Eager: return "eager";
+            case NTRU_ReduceKernel::Fold:  return "fold";
+            case NTRU_ReduceKernel::Lazy:  return "lazy";
+        }
+        return "";
+    }
+
+    /*
+     * Plans are persisted one per line as
+     * `<N> <d> <p> <q> <mul> <reduce> <cutoff> <grain>`, with blank lines and
+     * lines starting with '#' ignored. Loading is all or nothing: a malformed
+     * profile leaves the current plans untouched.
+     */
+    inline bool NTRU_SavePlans(std::string const& path)
+    {
+        std::ofstream file{path};
+        if (not file) return false;
+
+        NTRU_PlanTable table;
+        {
+            auto& registry = NTRU_GetPlanRegistry();
+            std::lock_guard<std::mutex> const lock{registry.mutex};
+            table = *registry.table.load(std::memory_order_acquire);
+        }
+
+        file << "# ntrux plan profile" << "\n";
+        for (auto const& [key,plan] : table)
+        {
+            file << key.N << ' ' << key.d << ' ' << key.p << ' ' << key.q
+                << ' ' << NTRU_GetName(plan.mul) << ' ' << NTRU_GetName(plan.reduce)
+                << ' ' << plan.cutoff << ' ' << plan.grain << "\n";
+        }
+        return bool(file);
+    }
+
+    inline bool NTRU_LoadPlans(std::string const& path)
+    {
+        std::ifstream file{path};
+        if (not file) return false;
+
+        NTRU_PlanTable loaded;
+        std::string line;
+
+        while (std::getline(file,line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream sst{line};
+            NTRU_PlanKey key;
+            size_t cutoff, grain;
+            std::string mul, reduce;
+            if (not (sst >> key.N >> key.d >> key.p >> key.q >> mul >> reduce >> cutoff >> grain)) return false;
+            if (cutoff == 0 || grain == 0 || not (sst >> std::ws).eof()) return false;
+
+            NTRU_Plan plan { NTRU_MulKernel::Schoolbook, NTRU_ReduceKernel::Eager, cutoff, grain };
+
+            if      (mul == NTRU_GetName(NTRU_MulKernel::Schoolbook)) plan.mul = NTRU_MulKernel::Schoolbook;
+            else if (mul == NTRU_GetName(NTRU_MulKernel::Sparse))     plan.mul = NTRU_MulKernel::Sparse;
+            else if (mul == NTRU_GetName(NTRU_MulKernel::Karatsuba))  plan.mul = NTRU_MulKernel::Karatsuba;
+            else if (mul == NTRU_GetName(NTRU_MulKernel::Parallel))   plan.mul = NTRU_MulKernel::Parallel;
+            else return false;
+
+            if      (reduce == NTRU_GetName(NTRU_ReduceKernel::Eager)) plan.reduce = NTRU_ReduceKernel::Eager;
+            else if (reduce == NTRU_GetName(NTRU_ReduceKernel::Fold))  plan.reduce = NTRU_ReduceKernel::Fold;
+            else if (reduce == NTRU_GetName(NTRU_ReduceKernel::Lazy))  plan.reduce = NTRU_ReduceKernel::Lazy;
+            else return false;
+
+            loaded[key] = plan;
+        }
+
+        NTRU_SetPlans(loaded);
+        return true;
+    }
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Standard Extensions
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include <iosfwd>
+
+namespace std
+{
+
+    template <typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_Plan const& plan)
+    {
+        return ost << '{' << ntru::NTRU_GetName(plan.mul) << ',' << ntru::NTRU_GetName(plan.reduce)
+            << ',' << plan.cutoff << ',' << plan.grain << '}';
+    }
+
+} // namespace std
+
+#endif // __HH_NTRU_PLAN
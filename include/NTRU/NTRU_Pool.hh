@@ -0,0 +1,227 @@
+
+#ifndef __HH_NTRU_POOL
+#define __HH_NTRU_POOL
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definition
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    /*
+     * A work-stealing thread pool. Every worker owns a deque: it pushes and
+     * pops its own tasks at the back, and when that runs dry it steals from
+     * the front of the others. Tasks submitted from outside the pool are
+     * dealt round-robin across the deques.
+     */
+    class NTRU_ThreadPool
+    {
+    public:
+        explicit NTRU_ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+        virtual ~NTRU_ThreadPool();
+
+        NTRU_ThreadPool(NTRU_ThreadPool const&) = delete;
+        NTRU_ThreadPool& operator=(NTRU_ThreadPool const&) = delete;
+
+    public:
+        void submit(std::function<void()>);
+        bool run_one();
+
+        auto size() const -> size_t { return m_Threads.size(); }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex{};
+            std::deque<std::function<void()>> tasks{};
+        };
+
+        void work(size_t index);
+
+    private:
+        std::vector<std::unique_ptr<Queue>> m_Queues{};
+        std::vector<std::thread> m_Threads{};
+        std::atomic<bool> m_Running{true};
+        std::atomic<size_t> m_Pending{0}, m_Next{0};
+        std::mutex m_SleepMutex{};
+        std::condition_variable m_SleepCondition{};
+
+        static inline thread_local NTRU_ThreadPool* s_Owner = nullptr;
+        static inline thread_local size_t s_Index = 0;
+    };
+
+    /*
+     * Fork-join scope over a pool. A thread waiting on the group keeps running
+     * pool tasks rather than blocking, so groups may nest freely. The first
+     * exception thrown by a task is rethrown from wait().
+     */
+    class NTRU_TaskGroup
+    {
+    public:
+        explicit NTRU_TaskGroup(NTRU_ThreadPool& pool) : m_Pool{pool} {}
+        virtual ~NTRU_TaskGroup() { join(); }
+
+        NTRU_TaskGroup(NTRU_TaskGroup const&) = delete;
+        NTRU_TaskGroup& operator=(NTRU_TaskGroup const&) = delete;
+
+    public:
+        template <typename Fn>
+        void run(Fn&& function);
+        void wait();
+
+    private:
+        void join();
+
+    private:
+        NTRU_ThreadPool& m_Pool;
+        std::atomic<size_t> m_Pending{0};
+        std::atomic<bool> m_Failed{false};
+        std::exception_ptr m_Error{};
+    };
+
+    inline NTRU_ThreadPool& NTRU_GetThreadPool()
+    {
+        static NTRU_ThreadPool pool;
+        return pool;
+    }
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    inline NTRU_ThreadPool::NTRU_ThreadPool(size_t thread_count)
+    {
+        thread_count = std::max<size_t>(thread_count,1);
+
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            m_Queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            m_Threads.emplace_back([this,i]() { work(i); });
+        }
+    }
+
+    inline NTRU_ThreadPool::~NTRU_ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> const lock{m_SleepMutex};
+            m_Running.store(false);
+        }
+        m_SleepCondition.notify_all();
+
+        for (auto& thread : m_Threads) thread.join();
+    }
+
+    inline void NTRU_ThreadPool::submit(std::function<void()> task)
+    {
+        size_t const index = s_Owner == this ? s_Index : m_Next.fetch_add(1) % m_Queues.size();
+        m_Pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> const lock{m_Queues[index]->mutex};
+            m_Queues[index]->tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> const lock{m_SleepMutex};
+        }
+        m_SleepCondition.notify_one();
+    }
+
+    inline bool NTRU_ThreadPool::run_one()
+    {
+        size_t const index = s_Owner == this ? s_Index : 0;
+        std::function<void()> task;
+
+        for (size_t i = 0; i < m_Queues.size() && not task; ++i)
+        {
+            auto& queue = *m_Queues[(index + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> const lock{queue.mutex};
+            if (queue.tasks.empty()) continue;
+
+            if (i == 0 && s_Owner == this) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+        if (not task) return false;
+
+        m_Pending.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    inline void NTRU_ThreadPool::work(size_t index)
+    {
+        s_Owner = this;
+        s_Index = index;
+
+        while (m_Running.load())
+        {
+            if (run_one()) continue;
+
+            std::unique_lock<std::mutex> lock{m_SleepMutex};
+            m_SleepCondition.wait(lock,[this]() { return not m_Running.load() || m_Pending.load() > 0; });
+        }
+    }
+
+    template <typename Fn>
+    void NTRU_TaskGroup::run(Fn&& function)
+    {
+        m_Pending.fetch_add(1);
+        m_Pool.submit([this,function=std::forward<Fn>(function)]()
+        {
+            struct Guard
+            {
+                std::atomic<size_t>& pending;
+                ~Guard() { pending.fetch_sub(1); }
+            } const guard{m_Pending};
+
+            try {
+                function();
+            } catch (...) {
+                if (not m_Failed.exchange(true)) m_Error = std::current_exception();
+            }
+        });
+    }
+
+    inline void NTRU_TaskGroup::join()
+    {
+        while (m_Pending.load() > 0)
+        {
+            if (not m_Pool.run_one()) std::this_thread::yield();
+        }
+    }
+
+    inline void NTRU_TaskGroup::wait()
+    {
+        join();
+        if (m_Error) std::rethrow_exception(std::exchange(m_Error,nullptr));
+    }
+
+} // namespace ntru
+
+#endif // __HH_NTRU_POOL
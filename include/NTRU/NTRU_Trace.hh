@@ -0,0 +1,315 @@
+
+#ifndef __HH_NTRU_TRACE
+#define __HH_NTRU_TRACE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Definition
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    enum class NTRU_Stage : size_t
+    {
+        Trinomial, Rejection, InverseP, InverseQ, Convolve, Reduce, CenterLift, Count
+    };
+
+    struct NTRU_ThreadTrace;
+
+    /*
+     * A log-linear latency histogram in nanoseconds. Values below 2^SubBits
+     * are counted exactly; above that every power of two is split into
+     * 2^SubBits buckets, bounding the relative error of any reported
+     * percentile to about 3%.
+     */
+    class NTRU_Histogram
+    {
+    public:
+        static constexpr size_t SubBits = 5;
+        static constexpr size_t SubCount = size_t{1} << SubBits;
+        static constexpr size_t BucketCount = (64 - SubBits + 1) * SubCount;
+
+        static auto index(uint64_t value) -> size_t;
+        static auto value(size_t index) -> uint64_t;
+
+    public:
+        void record(uint64_t value, uint64_t count = 1);
+        void merge(NTRU_Histogram const&);
+
+        auto count() const -> uint64_t { return m_Count; }
+        auto max() const -> uint64_t { return m_Max; }
+        auto mean() const -> double { return m_Count ? (double)m_Sum / (double)m_Count : 0.0; }
+        auto percentile(double) const -> uint64_t;
+
+    private:
+        friend struct NTRU_ThreadTrace;
+
+        std::array<uint64_t,BucketCount> m_Buckets{};
+        uint64_t m_Count{0}, m_Sum{0}, m_Max{0};
+    };
+
+    using NTRU_TraceReport = std::array<NTRU_Histogram,(size_t)NTRU_Stage::Count>;
+
+    /*
+     * Records the lifetime of a scope against a stage, when tracing is on.
+     * Each thread records into its own histograms; NTRU_TraceDump merges them.
+     */
+    class NTRU_StageTimer
+    {
+    public:
+        explicit NTRU_StageTimer(NTRU_Stage);
+        virtual ~NTRU_StageTimer();
+
+        NTRU_StageTimer(NTRU_StageTimer const&) = delete;
+        NTRU_StageTimer& operator=(NTRU_StageTimer const&) = delete;
+
+    private:
+        NTRU_Stage m_Stage;
+        bool m_Enabled;
+        std::chrono::steady_clock::time_point m_Start{};
+    };
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Implementation
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+namespace ntru
+{
+
+    inline size_t NTRU_Histogram::index(uint64_t value)
+    {
+        if (value < SubCount) return (size_t)value;
+
+        size_t const shift = (size_t)std::bit_width(value) - 1 - SubBits;
+        return (shift + 1) * SubCount + (size_t)(value >> shift) - SubCount;
+    }
+
+    inline uint64_t NTRU_Histogram::value(size_t index)
+    {
+        if (index < SubCount) return index;
+
+        size_t const shift = index / SubCount - 1;
+        return (uint64_t)(index % SubCount + SubCount) << shift;
+    }
+
+    inline void NTRU_Histogram::record(uint64_t value, uint64_t count)
+    {
+        m_Buckets[index(value)] += count;
+        m_Count += count;
+        m_Sum += value * count;
+        m_Max = std::max(m_Max,value);
+    }
+
+    inline void NTRU_Histogram::merge(NTRU_Histogram const& other)
+    {
+        for (size_t i = 0; i < BucketCount; ++i) m_Buckets[i] += other.m_Buckets[i];
+        m_Count += other.m_Count;
+        m_Sum += other.m_Sum;
+        m_Max = std::max(m_Max,other.m_Max);
+    }
+
+    inline uint64_t NTRU_Histogram::percentile(double percent) const
+    {
+        if (m_Count == 0) return 0;
+
+        auto const rank = (uint64_t)(percent / 100.0 * (double)(m_Count - 1)) + 1;
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BucketCount; ++i)
+        {
+            seen += m_Buckets[i];
+            if (seen >= rank) return std::min(value(i),m_Max);
+        }
+        return m_Max;
+    }
+
+    /*
+     * Per-thread trace storage. The owning thread records and NTRU_TraceReset
+     * clears from any thread, so every update is an atomic read-modify-write
+     * and a reset never loses to, or resurrects, a concurrent recording.
+     * Readers merging a dump may observe a recording in progress, which at
+     * worst skews that dump by one sample.
+     */
+    struct NTRU_ThreadTrace
+    {
+        struct Slot
+        {
+            std::array<std::atomic<uint64_t>,NTRU_Histogram::BucketCount> buckets{};
+            std::atomic<uint64_t> count{0}, sum{0}, max{0};
+        };
+        std::array<Slot,(size_t)NTRU_Stage::Count> slots{};
+
+        auto load(NTRU_Stage stage) const -> NTRU_Histogram
+        {
+            auto const& slot = slots[(size_t)stage];
+            NTRU_Histogram result;
+
+            for (size_t i = 0; i < NTRU_Histogram::BucketCount; ++i)
+            {
+                result.m_Buckets[i] = slot.buckets[i].load(std::memory_order_relaxed);
+            }
+            result.m_Count = slot.count.load(std::memory_order_relaxed);
+            result.m_Sum = slot.sum.load(std::memory_order_relaxed);
+            result.m_Max = slot.max.load(std::memory_order_relaxed);
+            return result;
+        }
+    };
+
+    struct NTRU_TraceRegistry
+    {
+        std::atomic<bool> enabled{false};
+        std::mutex mutex{};
+        std::vector<std::shared_ptr<NTRU_ThreadTrace>> traces{};
+    };
+
+    inline NTRU_TraceRegistry& NTRU_GetTraceRegistry()
+    {
+        static NTRU_TraceRegistry registry;
+        return registry;
+    }
+
+    inline NTRU_ThreadTrace& NTRU_GetThreadTrace()
+    {
+        thread_local std::shared_ptr<NTRU_ThreadTrace> const trace = []()
+        {
+            auto result = std::make_shared<NTRU_ThreadTrace>();
+            auto& registry = NTRU_GetTraceRegistry();
+
+            std::lock_guard<std::mutex> const lock{registry.mutex};
+            registry.traces.push_back(result);
+            return result;
+        }();
+        return *trace;
+    }
+
+    inline void NTRU_TraceEnable(bool enabled)
+    {
+        NTRU_GetTraceRegistry().enabled.store(enabled,std::memory_order_relaxed);
+    }
+
+    inline bool NTRU_TraceEnabled()
+    {
+        return NTRU_GetTraceRegistry().enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void NTRU_TraceRecord(NTRU_Stage stage, uint64_t nanoseconds)
+    {
+        auto& slot = NTRU_GetThreadTrace().slots[(size_t)stage];
+
+        slot.buckets[NTRU_Histogram::index(nanoseconds)].fetch_add(1,std::memory_order_relaxed);
+        slot.count.fetch_add(1,std::memory_order_relaxed);
+        slot.sum.fetch_add(nanoseconds,std::memory_order_relaxed);
+
+        auto max = slot.max.load(std::memory_order_relaxed);
+        while (nanoseconds > max && not slot.max.compare_exchange_weak(max,nanoseconds,std::memory_order_relaxed));
+    }
+
+    inline NTRU_TraceReport NTRU_TraceDump()
+    {
+        auto& registry = NTRU_GetTraceRegistry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+
+        NTRU_TraceReport report;
+        for (auto const& trace : registry.traces)
+        {
+            for (size_t stage = 0; stage < report.size(); ++stage)
+            {
+                report[stage].merge(trace->load((NTRU_Stage)stage));
+            }
+        }
+        return report;
+    }
+
+    inline void NTRU_TraceReset()
+    {
+        auto& registry = NTRU_GetTraceRegistry();
+        std::lock_guard<std::mutex> const lock{registry.mutex};
+
+        for (auto const& trace : registry.traces)
+        {
+            for (auto& slot : trace->slots)
+            {
+                for (auto& bucket : slot.buckets) bucket.store(0,std::memory_order_relaxed);
+                slot.count.store(0,std::memory_order_relaxed);
+                slot.sum.store(0,std::memory_order_relaxed);
+                slot.max.store(0,std::memory_order_relaxed);
+            }
+        }
+    }
+
+    inline NTRU_StageTimer::NTRU_StageTimer(NTRU_Stage stage)
+        : m_Stage{stage}
+        , m_Enabled{NTRU_TraceEnabled()}
+    {
+        if (m_Enabled) m_Start = std::chrono::steady_clock::now();
+    }
+
+    inline NTRU_StageTimer::~NTRU_StageTimer()
+    {
+        if (not m_Enabled) return;
+
+        auto const elapsed = std::chrono::steady_clock::now() - m_Start;
+        NTRU_TraceRecord(m_Stage,(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    inline char const* NTRU_GetName(NTRU_Stage stage)
+    {
+        switch (stage)
+        {
+            case NTRU_Stage::Trinomial:  return "trinomial";
+            case NTRU_Stage::Rejection:  return "rejection";
+            case NTRU_Stage::InverseP:   return "inverse_p";
+            case NTRU_Stage::InverseQ:   return "inverse_q";
+            case NTRU_Stage::Convolve:   return "convolve";
+            case NTRU_Stage::Reduce:     return "reduce";
+            case NTRU_Stage::CenterLift: return "center_lift";
+            default:                     return "";
+        }
+    }
+
+} // namespace ntru
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+// Standard Extensions
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include <iosfwd>
+
+namespace std
+{
+
+    template <typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_Histogram const& histogram)
+    {
+        return ost << '{' << histogram.count() << ',' << histogram.percentile(50) << ','
+            << histogram.percentile(90) << ',' << histogram.percentile(99) << ','
+            << histogram.percentile(99.9) << ',' << histogram.max() << '}';
+    }
+
+    template <typename Ch>
+    basic_ostream<Ch>& operator<<(basic_ostream<Ch>& ost, ntru::NTRU_TraceReport const& report)
+    {
+        for (size_t stage = 0; stage < report.size(); ++stage)
+        {
+            if (report[stage].count() == 0) continue;
+            ost << ntru::NTRU_GetName((ntru::NTRU_Stage)stage) << " = " << report[stage] << "\n";
+        }
+        return ost;
+    }
+
+} // namespace std
+
+#endif // __HH_NTRU_TRACE
@@ -0,0 +1,101 @@
+
+#ifndef __HH_NTRU_TUNE
+#define __HH_NTRU_TUNE
+
+#include "NTRU_Keys.hh"
+#include "NTRU_Plan.hh"
+#include "NTRU_Poly.hh"
+#include "NTRU_Util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace ntru
+{
+
+    template <typename Fn>
+    inline double NTRU_Benchmark(size_t rounds, Fn&& function)
+    {
+        std::vector<double> samples;
+        samples.reserve(rounds);
+
+        for (size_t i = 0; i < rounds; ++i)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            function();
+            auto const stop = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double>(stop - start).count());
+        }
+
+        std::nth_element(samples.begin(),samples.begin()+samples.size()/2,samples.end());
+        return samples[samples.size()/2];
+    }
+
+    /*
+     * Microbenchmarks every multiplication and reduction pipeline on operands
+     * shaped like the library's own convolutions (a dense polynomial mod q
+     * against a ternary one), sweeping the Karatsuba cutoff and, for the
+     * parallel kernel, the serial grain below which it stops forking. The
+     * fastest combination is recorded as the plan for `seed` and returned.
+     * Operands come from a private generator so the global `rand()` stream
+     * used for key material is left untouched.
+     */
+    template <typename Tp>
+    NTRU_Plan NTRU_Tune(NTRU_Seed<Tp> const& seed, size_t rounds = 16)
+    {
+        std::minstd_rand engine{(unsigned int)seed.N};
+        rounds = std::max<size_t>(rounds,1);
+
+        std::vector<Tp> coeffs_dense(seed.N), coeffs_ternary(seed.N,Tp{});
+        for (auto& coeff : coeffs_dense) coeff = (Tp)(engine() % (unsigned long)seed.q);
+        for (size_t i = 0; i < 2*seed.d && i < seed.N; ++i) coeffs_ternary[i] = i < seed.d ? 1 : -1;
+        std::shuffle(coeffs_ternary.begin(),coeffs_ternary.end(),engine);
+
+        auto const poly_dense = Poly<Tp>{std::move(coeffs_dense)};
+        auto const poly_ternary = Poly<Tp>{std::move(coeffs_ternary)};
+
+        std::vector<NTRU_Plan> candidates;
+        for (auto const reduce : { NTRU_ReduceKernel::Eager, NTRU_ReduceKernel::Fold })
+        {
+            candidates.push_back({ NTRU_MulKernel::Schoolbook, reduce, 32 });
+            candidates.push_back({ NTRU_MulKernel::Sparse, reduce, 32 });
+
+            for (size_t cutoff = 8; cutoff < seed.N; cutoff *= 2)
+            {
+                candidates.push_back({ NTRU_MulKernel::Karatsuba, reduce, cutoff });
+            }
+            for (size_t cutoff = 8; cutoff < seed.N / 8 && NTRU_GetThreadPool().size() > 1; cutoff *= 2)
+            {
+                for (size_t grain = 2*cutoff; grain < seed.N; grain *= 2)
+                {
+                    candidates.push_back({ NTRU_MulKernel::Parallel, reduce, cutoff, grain });
+                }
+            }
+        }
+        candidates.push_back({ NTRU_MulKernel::Schoolbook, NTRU_ReduceKernel::Lazy, 32 });
+
+        NTRU_Plan best = candidates.front();
+        double best_time = -1;
+
+        for (auto const& candidate : candidates)
+        {
+            double const time = NTRU_Benchmark(rounds,[&]()
+            {
+                auto const product = candidate.reduce == NTRU_ReduceKernel::Lazy
+                    ? NTRU_ConvolveLazy(seed.N,seed.q,poly_dense,poly_ternary)
+                    : NTRU_Reduce(candidate,seed.N,seed.q,NTRU_Multiply(candidate,poly_dense,poly_ternary));
+                volatile auto const size = product.size();
+                (void)size;
+            });
+            if (best_time < 0 || time < best_time) { best = candidate; best_time = time; }
+        }
+
+        NTRU_SetPlan(seed,best);
+        return best;
+    }
+
+} // namespace ntru
+
+#endif // __HH_NTRU_TUNE
@@ -3,17 +3,27 @@
 #define __HH_NTRU_UTIL
 
 #include "NTRU_Keys.hh"
+#include "NTRU_Plan.hh"
 #include "NTRU_Poly.hh"
+#include "NTRU_Pool.hh"
+#include "NTRU_Trace.hh"
 
 #include <array>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
 #include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
 
 namespace ntru
 {
 
-    template <typename Tp>
-    inline Poly<Tp> NTRU_GenTrinomial(size_t degree, size_t d1, size_t d2)
+    template <typename Tp, typename Engine>
+    inline Poly<Tp> NTRU_GenTrinomial(size_t degree, size_t d1, size_t d2, Engine& engine)
     {
         std::array<size_t,3> queue { d2, degree-d1-d2, d1 };
 
@@ -22,15 +32,36 @@ namespace ntru
 
         while (queue[0]+queue[1]+queue[2] != 0)
         {
-            auto const random = rand() % 3;
+            auto const random = (size_t)(engine() % 3);
             if (queue[random] > 0) {
                 queue[random] -= 1;
-                coeffs.push_back(random-1);
+                coeffs.push_back((Tp)random-1);
             }
         }
         return Poly<Tp>{std::move(coeffs)};
     }
 
+    template <typename Tp>
+    inline Poly<Tp> NTRU_GenTrinomial(size_t degree, size_t d1, size_t d2)
+    {
+        auto engine = []() { return rand(); };
+        return NTRU_GenTrinomial<Tp>(degree,d1,d2,engine);
+    }
+
+    /*
+     * A generator whose entire state is seeded from the system entropy
+     * source, rather than from a single 32-bit random_device value.
+     */
+    inline std::mt19937_64 NTRU_GetEngine()
+    {
+        std::random_device device;
+        std::array<std::random_device::result_type,2*std::mt19937_64::state_size> words;
+        std::generate(words.begin(),words.end(),std::ref(device));
+
+        std::seed_seq sequence(words.begin(),words.end());
+        return std::mt19937_64{sequence};
+    }
+
     template <typename Tp>
     Poly<Tp> NTRU_Reduce(Tp const& modulo, Poly<Tp> const& poly)
     {
@@ -44,18 +75,67 @@ namespace ntru
         return result;
     }
 
+    /*
+     * Accumulator wide enough to hold a product of `Ta` and `Tb` with headroom
+     * for many additions before a modular reduction is required.
+     */
+    template <typename Ta, typename Tb>
+    using NTRU_Accum = std::conditional_t<(sizeof(Ta)+sizeof(Tb) <= 3),int32_t,int64_t>;
+
+    template <typename To, typename Tp>
+    Poly<To> NTRU_Cast(Poly<Tp> const& poly)
+    {
+        return Poly<To>{std::vector<To>(poly.coeffs().begin(),poly.coeffs().end())};
+    }
+
+    /*
+     * Number of products of terms bounded in magnitude by `bound1` and `bound2`
+     * that may be added to an accumulator already bounded by `modulo` before
+     * it can overflow.
+     */
+    template <typename Acc>
+    size_t NTRU_GetHeadroom(Acc const& modulo, Acc const& bound1, Acc const& bound2)
+    {
+        if (bound1 == 0 || bound2 == 0) return std::numeric_limits<size_t>::max();
+        auto const headroom = (std::numeric_limits<Acc>::max() - modulo) / bound1 / bound2;
+        return std::max<size_t>((size_t)headroom,1);
+    }
+
     template <typename Tp>
     Poly<Tp> NTRU_Reduce(size_t degree, Tp const& modulo, Poly<Tp> const& poly)
     {
-        Poly<Tp> result;
+        using Acc = NTRU_Accum<Tp,int8_t>;
+        using Mag = std::make_unsigned_t<Acc>;
 
-        for (size_t i = 0; i < poly.size(); ++i)
+        // The magnitude bound of Tp is computed unsigned, as -min() does not
+        // fit Acc when Tp is 64 bits wide. If not even one unreduced row fits,
+        // every coefficient is reduced before it is added.
+        auto const& coeffs = poly.coeffs();
+        auto const bound = std::max<Mag>((Mag)std::numeric_limits<Tp>::max(),Mag{0}-(Mag)std::numeric_limits<Tp>::min());
+        auto const rows = ((Mag)std::numeric_limits<Acc>::max() - (Mag)modulo) / bound;
+        size_t const headroom = std::max<size_t>((size_t)rows,1);
+
+        std::vector<Acc> accum(std::min(degree,coeffs.size()),Acc{});
+
+        for (size_t row = 0, base = 0; base < coeffs.size(); ++row, base += degree)
         {
-            size_t const index = i % degree;
-            result[index] = (result[index] + poly[i]) % modulo;
-            if (result[index] < 0) result[index] += modulo;
+            if (row != 0 && row % headroom == 0)
+            {
+                for (auto& value : accum) value %= modulo;
+            }
+            for (size_t i = base; i < std::min(base+degree,coeffs.size()); ++i)
+            {
+                accum[i-base] += rows != 0 ? (Acc)coeffs[i] : (Acc)(coeffs[i] % modulo);
+            }
         }
-        return result;
+
+        std::vector<Tp> result(accum.size());
+        for (size_t i = 0; i < accum.size(); ++i)
+        {
+            auto const value = accum[i] % modulo;
+            result[i] = (Tp)(value < 0 ? value + modulo : value);
+        }
+        return Poly<Tp>{std::move(result)};
     }
 
     template <typename Tp>
@@ -71,6 +151,335 @@ namespace ntru
         return result;
     }
 
+    template <typename Tp>
+    NTRU_SparsePoly NTRU_GetSparse(Poly<Tp> const& poly)
+    {
+        NTRU_SparsePoly result;
+
+        for (size_t i = 0; i < poly.size(); ++i)
+        {
+            if (poly[i] == +1) result.index_pos.push_back(i);
+            if (poly[i] == -1) result.index_neg.push_back(i);
+        }
+        return result;
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_SparseConvolve(size_t degree, Tp const& modulo, NTRU_SparsePoly const& sparse, Poly<Tp> const& poly)
+    {
+        std::vector<Tp> coeffs(degree,Tp{});
+
+        for (size_t j = 0; j < poly.size(); ++j)
+        {
+            size_t const offset = j % degree;
+
+            for (size_t const i : sparse.index_pos)
+            {
+                size_t const index = (i % degree) + offset;
+                coeffs[index < degree ? index : index - degree] += poly[j];
+            }
+            for (size_t const i : sparse.index_neg)
+            {
+                size_t const index = (i % degree) + offset;
+                coeffs[index < degree ? index : index - degree] -= poly[j];
+            }
+        }
+        return NTRU_Reduce(modulo,Poly<Tp>{std::move(coeffs)});
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_ReduceFold(size_t degree, Tp const& modulo, Poly<Tp> const& poly)
+    {
+        std::vector<Tp> coeffs(std::min(degree,poly.size()),Tp{});
+
+        for (size_t i = 0; i < poly.size(); ++i)
+        {
+            coeffs[i % degree] += poly.coeffs()[i];
+        }
+        return NTRU_Reduce(modulo,Poly<Tp>{std::move(coeffs)});
+    }
+
+    /*
+     * The multiplication kernels below accumulate in `Acc`, which defaults to
+     * the operand type; NTRU_Multiply widens it so that dense products mod q,
+     * which can sum to N*(q-1)^2, do not overflow before they are reduced.
+     */
+    template <typename Acc = void, typename Tp>
+    auto NTRU_MulSparse(Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        using Result = std::conditional_t<std::is_void_v<Acc>,Tp,Acc>;
+
+        auto const& coeffs1 = poly1.coeffs();
+        auto const& coeffs2 = poly2.coeffs();
+        if (coeffs1.empty() || coeffs2.empty()) return Poly<Result>{};
+
+        auto const nonzero1 = coeffs1.size() - std::count(coeffs1.begin(),coeffs1.end(),Tp{});
+        auto const nonzero2 = coeffs2.size() - std::count(coeffs2.begin(),coeffs2.end(),Tp{});
+        if (nonzero1 > nonzero2) return NTRU_MulSparse<Result>(poly2,poly1);
+
+        std::vector<Result> coeffs(coeffs1.size()+coeffs2.size()-1,Result{});
+
+        for (size_t i = 0; i < coeffs1.size(); ++i)
+        {
+            if (coeffs1[i] == Tp{}) continue;
+
+            for (size_t j = 0; j < coeffs2.size(); ++j)
+            {
+                coeffs[i+j] += (Result)coeffs1[i] * coeffs2[j];
+            }
+        }
+        return Poly<Result>{std::move(coeffs)};
+    }
+
+    /*
+     * Schoolbook product of unbalanced operands; Karatsuba pads both halves to
+     * the longer length, which only pays off when both are long.
+     */
+    template <typename Acc, typename Tp>
+    Poly<Acc> NTRU_MulShort(Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        auto const& coeffs1 = poly1.coeffs();
+        auto const& coeffs2 = poly2.coeffs();
+        std::vector<Acc> coeffs(coeffs1.size()+coeffs2.size()-1,Acc{});
+
+        for (size_t i = 0; i < coeffs1.size(); ++i)
+        {
+            for (size_t j = 0; j < coeffs2.size(); ++j)
+            {
+                coeffs[i+j] += (Acc)coeffs1[i] * coeffs2[j];
+            }
+        }
+        return Poly<Acc>{std::move(coeffs)};
+    }
+
+    template <typename Tp>
+    void NTRU_MulKaratsuba(Tp const* poly1, Tp const* poly2, size_t length, Tp* result, size_t cutoff)
+    {
+        if (length <= cutoff)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                for (size_t j = 0; j < length; ++j)
+                {
+                    result[i+j] += poly1[i] * poly2[j];
+                }
+            }
+            return;
+        }
+
+        size_t const lo = length / 2;
+        size_t const hi = length - lo;
+
+        std::vector<Tp> sum1(poly1+lo,poly1+length), sum2(poly2+lo,poly2+length);
+        for (size_t i = 0; i < lo; ++i)
+        {
+            sum1[i] += poly1[i];
+            sum2[i] += poly2[i];
+        }
+
+        std::vector<Tp> z0(2*lo,Tp{}), z1(2*hi,Tp{}), z2(2*hi,Tp{});
+        NTRU_MulKaratsuba(poly1,poly2,lo,z0.data(),cutoff);
+        NTRU_MulKaratsuba(poly1+lo,poly2+lo,hi,z2.data(),cutoff);
+        NTRU_MulKaratsuba(sum1.data(),sum2.data(),hi,z1.data(),cutoff);
+
+        for (size_t i = 0; i < z0.size(); ++i) z1[i] -= z0[i];
+        for (size_t i = 0; i < z2.size(); ++i) z1[i] -= z2[i];
+
+        for (size_t i = 0; i < z0.size(); ++i) result[i] += z0[i];
+        for (size_t i = 0; i < z1.size(); ++i) result[lo+i] += z1[i];
+        for (size_t i = 0; i < z2.size(); ++i) result[2*lo+i] += z2[i];
+    }
+
+    template <typename Acc = void, typename Tp>
+    auto NTRU_MulKaratsuba(Poly<Tp> const& poly1, Poly<Tp> const& poly2, size_t cutoff = 32)
+    {
+        using Result = std::conditional_t<std::is_void_v<Acc>,Tp,Acc>;
+
+        if (poly1.size() == 0 || poly2.size() == 0) return Poly<Result>{};
+        if (std::min(poly1.size(),poly2.size()) <= cutoff) return NTRU_MulShort<Result>(poly1,poly2);
+
+        size_t const length = std::max(poly1.size(),poly2.size());
+        std::vector<Result> coeffs1(poly1.coeffs().begin(),poly1.coeffs().end());
+        std::vector<Result> coeffs2(poly2.coeffs().begin(),poly2.coeffs().end());
+        coeffs1.resize(length);
+        coeffs2.resize(length);
+
+        std::vector<Result> coeffs(2*length,Result{});
+        NTRU_MulKaratsuba(coeffs1.data(),coeffs2.data(),length,coeffs.data(),std::max<size_t>(cutoff,1));
+
+        coeffs.resize(poly1.size()+poly2.size()-1);
+        return Poly<Result>{std::move(coeffs)};
+    }
+
+    template <typename Tp>
+    void NTRU_MulParallel(NTRU_ThreadPool& pool, Tp const* poly1, Tp const* poly2, size_t length, Tp* result,
+        size_t cutoff, size_t grain)
+    {
+        if (length <= grain)
+        {
+            NTRU_MulKaratsuba(poly1,poly2,length,result,cutoff);
+            return;
+        }
+
+        size_t const lo = length / 2;
+        size_t const hi = length - lo;
+
+        std::vector<Tp> sum1(poly1+lo,poly1+length), sum2(poly2+lo,poly2+length);
+        for (size_t i = 0; i < lo; ++i)
+        {
+            sum1[i] += poly1[i];
+            sum2[i] += poly2[i];
+        }
+
+        std::vector<Tp> z0(2*lo,Tp{}), z1(2*hi,Tp{}), z2(2*hi,Tp{});
+        {
+            NTRU_TaskGroup group{pool};
+            group.run([&]() { NTRU_MulParallel(pool,poly1,poly2,lo,z0.data(),cutoff,grain); });
+            group.run([&]() { NTRU_MulParallel(pool,poly1+lo,poly2+lo,hi,z2.data(),cutoff,grain); });
+            NTRU_MulParallel(pool,sum1.data(),sum2.data(),hi,z1.data(),cutoff,grain);
+            group.wait();
+        }
+
+        for (size_t i = 0; i < z0.size(); ++i) z1[i] -= z0[i];
+        for (size_t i = 0; i < z2.size(); ++i) z1[i] -= z2[i];
+
+        for (size_t i = 0; i < z0.size(); ++i) result[i] += z0[i];
+        for (size_t i = 0; i < z1.size(); ++i) result[lo+i] += z1[i];
+        for (size_t i = 0; i < z2.size(); ++i) result[2*lo+i] += z2[i];
+    }
+
+    /*
+     * Karatsuba multiplication whose three subproducts are forked onto the
+     * work-stealing pool until they shrink to `grain` coefficients, below which
+     * each runs serially. The arithmetic is exact, so the result does not
+     * depend on how the work was scheduled.
+     */
+    template <typename Acc = void, typename Tp>
+    auto NTRU_MulParallel(Poly<Tp> const& poly1, Poly<Tp> const& poly2, size_t cutoff = 32, size_t grain = 256)
+    {
+        using Result = std::conditional_t<std::is_void_v<Acc>,Tp,Acc>;
+
+        if (poly1.size() == 0 || poly2.size() == 0) return Poly<Result>{};
+        if (std::min(poly1.size(),poly2.size()) <= cutoff) return NTRU_MulShort<Result>(poly1,poly2);
+
+        size_t const length = std::max(poly1.size(),poly2.size());
+        std::vector<Result> coeffs1(poly1.coeffs().begin(),poly1.coeffs().end());
+        std::vector<Result> coeffs2(poly2.coeffs().begin(),poly2.coeffs().end());
+        coeffs1.resize(length);
+        coeffs2.resize(length);
+
+        std::vector<Result> coeffs(2*length,Result{});
+        NTRU_MulParallel(NTRU_GetThreadPool(),coeffs1.data(),coeffs2.data(),length,coeffs.data(),
+            std::max<size_t>(cutoff,1),std::max<size_t>(grain,cutoff));
+
+        coeffs.resize(poly1.size()+poly2.size()-1);
+        return Poly<Result>{std::move(coeffs)};
+    }
+
+    /*
+     * Cyclic convolution in Z_modulo[x]/(x^degree-1) over operands of any
+     * storage width, e.g. a uint16_t polynomial mod q against an int8_t
+     * ternary one. Products are summed in a wide accumulator and reduced only
+     * when the bound derived from the operand magnitudes says the next pass
+     * could overflow, which for practical parameters means once at the end.
+     * The result is stored as `Tr`, which defaults to the modulus type and
+     * must hold modulo-1; the modulus itself never has to fit it, so a
+     * uint16_t result mod 2^16 is fine.
+     */
+    template <typename Tr = void, typename Tm, typename Ta, typename Tb>
+    auto NTRU_ConvolveLazy(size_t degree, Tm const& modulo, Poly<Ta> const& poly1, Poly<Tb> const& poly2)
+    {
+        using Result = std::conditional_t<std::is_void_v<Tr>,Tm,Tr>;
+        using Acc = std::conditional_t<(sizeof(Result) <= 2),NTRU_Accum<Ta,Tb>,int64_t>;
+
+        auto const fold = [degree,modulo](auto const& coeffs)
+        {
+            std::vector<Acc> result(degree,Acc{});
+            for (size_t i = 0; i < coeffs.size(); ++i) result[i % degree] += coeffs[i];
+            if (coeffs.size() > degree) for (auto& value : result) value %= (Acc)modulo;
+            return result;
+        };
+        auto const magnitude = [](std::vector<Acc> const& coeffs)
+        {
+            Acc result{};
+            for (auto const value : coeffs) result = std::max<Acc>(result,value < 0 ? -value : value);
+            return result;
+        };
+
+        auto coeffs1 = fold(poly1.coeffs());
+        auto coeffs2 = fold(poly2.coeffs());
+        if (std::count(coeffs1.begin(),coeffs1.end(),Acc{}) < std::count(coeffs2.begin(),coeffs2.end(),Acc{}))
+        {
+            std::swap(coeffs1,coeffs2);
+        }
+        size_t const headroom = NTRU_GetHeadroom<Acc>((Acc)modulo,magnitude(coeffs1),magnitude(coeffs2));
+
+        std::vector<Acc> accum(degree,Acc{});
+        size_t pending = 0;
+
+        for (size_t i = 0; i < degree; ++i)
+        {
+            auto const coeff = coeffs1[i];
+            if (coeff == 0) continue;
+
+            if (pending == headroom)
+            {
+                for (auto& value : accum) value %= (Acc)modulo;
+                pending = 0;
+            }
+            for (size_t j = 0; j < degree-i; ++j) accum[i+j] += coeff * coeffs2[j];
+            for (size_t j = degree-i; j < degree; ++j) accum[i+j-degree] += coeff * coeffs2[j];
+            pending += 1;
+        }
+
+        std::vector<Result> result(degree);
+        for (size_t i = 0; i < degree; ++i)
+        {
+            auto const value = accum[i] % (Acc)modulo;
+            result[i] = (Result)(value < 0 ? value + (Acc)modulo : value);
+        }
+        return Poly<Result>{std::move(result)};
+    }
+
+    /*
+     * Unreduced product in the wide type `NTRU_Accum<Tp,Tp>`; NTRU_Reduce with
+     * the same plan brings it back into `Tp`.
+     */
+    template <typename Tp>
+    Poly<NTRU_Accum<Tp,Tp>> NTRU_Multiply(NTRU_Plan const& plan, Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        using Acc = NTRU_Accum<Tp,Tp>;
+
+        switch (plan.mul)
+        {
+            case NTRU_MulKernel::Sparse:    return NTRU_MulSparse<Acc>(poly1,poly2);
+            case NTRU_MulKernel::Karatsuba: return NTRU_MulKaratsuba<Acc>(poly1,poly2,plan.cutoff);
+            case NTRU_MulKernel::Parallel:  return NTRU_MulParallel<Acc>(poly1,poly2,plan.cutoff,plan.grain);
+            default:                        return NTRU_Cast<Acc>(poly1) * NTRU_Cast<Acc>(poly2);
+        }
+    }
+
+    template <typename Tp, typename Acc>
+    Poly<Tp> NTRU_Reduce(NTRU_Plan const& plan, size_t degree, Tp const& modulo, Poly<Acc> const& poly)
+    {
+        auto const reduced = plan.reduce == NTRU_ReduceKernel::Fold
+            ? NTRU_ReduceFold(degree,(Acc)modulo,poly)
+            : NTRU_Reduce(degree,(Acc)modulo,poly);
+
+        if constexpr (std::is_same_v<Tp,Acc>) {
+            return reduced;
+        } else {
+            return NTRU_Cast<Tp>(reduced);
+        }
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_Convolve(NTRU_Plan const& plan, size_t degree, Tp const& modulo, Poly<Tp> const& poly1, Poly<Tp> const& poly2)
+    {
+        if (plan.reduce == NTRU_ReduceKernel::Lazy) return NTRU_ConvolveLazy(degree,modulo,poly1,poly2);
+        return NTRU_Reduce(plan,degree,modulo,NTRU_Multiply(plan,poly1,poly2));
+    }
+
     template <typename Tp>
     Tp NTRU_GCD(Tp const& a, Tp const& b)
     {
@@ -150,7 +559,12 @@ namespace ntru
             auto const [rm,qm] = NTRU_DivisionRQ(modulo,rn[0],rn[1]);
             rn = { rn[1], rm };
         }
-        return NTRU_Reduce(degree,modulo,rn[0]);
+
+        auto const result = NTRU_Reduce(degree,modulo,rn[0]);
+        if (result == Poly<Tp>{0}) return result;
+
+        auto const [x,y] = NTRU_ExGCD(modulo,result.back());
+        return NTRU_Reduce(degree,modulo,y * result);
     }
 
     template <typename Tp>
@@ -159,11 +573,19 @@ namespace ntru
         return NTRU_QuotientGCD(degree,modulo,poly) == Poly<Tp>{1};
     }
 
+    /*
+     * Runs the extended Euclidean algorithm against x^degree-1, returning the
+     * monic gcd together with s such that s*poly = gcd in the ring. The Bezout
+     * coefficient is reduced every step so it never outgrows `Tp`, and each
+     * step's product goes through the plan's kernels, which accumulate wide.
+     * The poly is invertible exactly when the gcd is 1, in which case s is
+     * its inverse.
+     */
     template <typename Tp>
-    Poly<Tp> NTRU_GetInverse(size_t degree, Tp const& modulo, Poly<Tp> const& poly)
+    std::array<Poly<Tp>,2> NTRU_GetInverseGCD(NTRU_Plan const& plan, size_t degree, Tp const& modulo, Poly<Tp> const& poly)
     {
-        std::array<std::array<Poly<Tp>,2>,2> sn = {
-            Poly<Tp>{1}, Poly<Tp>{0}, Poly<Tp>{0}, Poly<Tp>{1}
+        std::array<Poly<Tp>,2> sn = {
+            Poly<Tp>{0}, Poly<Tp>{1}
         };
         std::array<Poly<Tp>,2> rn = {
             NTRU_GetQuotient<Tp>(degree), NTRU_Reduce(degree,modulo,poly)
@@ -172,13 +594,107 @@ namespace ntru
         while (rn[1] != Poly<Tp>{0})
         {
             auto const [rm,qm] = NTRU_DivisionRQ(modulo,rn[0],rn[1]);
-            sn[0] = { sn[0][0] - qm * sn[1][0], sn[0][1] - qm * sn[1][1] };
-            sn = { sn[1], sn[0] };
+            sn = { sn[1], NTRU_Reduce(degree,modulo,sn[0] - NTRU_Convolve(plan,degree,modulo,qm,sn[1])) };
             rn = { rn[1], rm };
         }
 
-        if (rn[0] < Poly<Tp>{0}) sn[0] = { -sn[0][1], -sn[0][0] };
-        return NTRU_Reduce(degree,modulo,sn[0][1]);
+        auto const result = NTRU_Reduce(degree,modulo,rn[0]);
+        if (result == Poly<Tp>{0}) return { result, NTRU_Reduce(degree,modulo,sn[0]) };
+
+        auto const [x,y] = NTRU_ExGCD(modulo,result.back());
+        return { NTRU_Reduce(degree,modulo,y * result), NTRU_Reduce(degree,modulo,y * sn[0]) };
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_GetInverse(NTRU_Plan const& plan, size_t degree, Tp const& modulo, Poly<Tp> const& poly)
+    {
+        return NTRU_GetInverseGCD(plan,degree,modulo,poly)[1];
+    }
+
+    template <typename Tp>
+    Poly<Tp> NTRU_GetInverse(size_t degree, Tp const& modulo, Poly<Tp> const& poly)
+    {
+        return NTRU_GetInverse(NTRU_Plan{},degree,modulo,poly);
+    }
+
+    template <typename Tp>
+    void NTRU_GetProductTree(NTRU_Plan const& plan, size_t degree, Tp const& modulo, std::vector<Poly<Tp>> const& polys,
+        std::vector<Poly<Tp>>& tree, size_t node, size_t lo, size_t hi)
+    {
+        if (hi - lo == 1)
+        {
+            tree[node] = NTRU_Reduce(degree,modulo,polys[lo]);
+            return;
+        }
+
+        size_t const mid = lo + (hi - lo) / 2;
+        NTRU_GetProductTree(plan,degree,modulo,polys,tree,2*node+1,lo,mid);
+        NTRU_GetProductTree(plan,degree,modulo,polys,tree,2*node+2,mid,hi);
+        tree[node] = NTRU_Convolve(plan,degree,modulo,tree[2*node+1],tree[2*node+2]);
+    }
+
+    template <typename Tp>
+    void NTRU_GetInverseTree(NTRU_Plan const& plan, size_t degree, Tp const& modulo, std::vector<Poly<Tp>> const& tree,
+        std::vector<Poly<Tp>>& inverses, size_t node, size_t lo, size_t hi, Poly<Tp> const* inverse)
+    {
+        Poly<Tp> local;
+
+        if (inverse == nullptr)
+        {
+            auto const [gcd,result] = NTRU_GetInverseGCD(plan,degree,modulo,tree[node]);
+            if (gcd == Poly<Tp>{1})
+            {
+                local = result;
+                inverse = &local;
+            }
+            else if (hi - lo == 1) return;
+        }
+
+        if (hi - lo == 1)
+        {
+            inverses[lo] = *inverse;
+            return;
+        }
+
+        size_t const mid = lo + (hi - lo) / 2;
+        if (inverse != nullptr)
+        {
+            auto const inverse_lo = NTRU_Convolve(plan,degree,modulo,*inverse,tree[2*node+2]);
+            auto const inverse_hi = NTRU_Convolve(plan,degree,modulo,*inverse,tree[2*node+1]);
+            NTRU_GetInverseTree(plan,degree,modulo,tree,inverses,2*node+1,lo,mid,&inverse_lo);
+            NTRU_GetInverseTree(plan,degree,modulo,tree,inverses,2*node+2,mid,hi,&inverse_hi);
+        } else {
+            NTRU_GetInverseTree(plan,degree,modulo,tree,inverses,2*node+1,lo,mid,(Poly<Tp> const*)nullptr);
+            NTRU_GetInverseTree(plan,degree,modulo,tree,inverses,2*node+2,mid,hi,(Poly<Tp> const*)nullptr);
+        }
+    }
+
+    /*
+     * Inverts many polynomials in the same ring with Montgomery's trick: the
+     * candidates are multiplied up a product tree, only the root is inverted,
+     * and each leaf's inverse is recovered on the way down by multiplying with
+     * its sibling products. A subtree whose product is not invertible is split
+     * and its halves inverted separately, isolating the offending candidates,
+     * whose entries are left empty (`size() == 0`) in the result. The tree
+     * products are dense mod q and go through the plan's multiplication kernel.
+     */
+    template <typename Tp>
+    std::vector<Poly<Tp>> NTRU_GetInverseBatch(NTRU_Plan const& plan, size_t degree, Tp const& modulo,
+        std::vector<Poly<Tp>> const& polys)
+    {
+        std::vector<Poly<Tp>> inverses(polys.size());
+        if (polys.empty()) return inverses;
+
+        std::vector<Poly<Tp>> tree(4*polys.size());
+        NTRU_GetProductTree(plan,degree,modulo,polys,tree,0,0,polys.size());
+        NTRU_GetInverseTree(plan,degree,modulo,tree,inverses,0,0,polys.size(),(Poly<Tp> const*)nullptr);
+        return inverses;
+    }
+
+    template <typename Tp>
+    std::vector<Poly<Tp>> NTRU_GetInverseBatch(size_t degree, Tp const& modulo, std::vector<Poly<Tp>> const& polys)
+    {
+        return NTRU_GetInverseBatch(NTRU_Plan{},degree,modulo,polys);
     }
 
     template <typename Tp>
@@ -211,6 +727,94 @@ namespace ntru
         return valid;
     }
 
+    /*
+     * Expands a product-form basis into the dense f = 1 + p*(f1*f2 + f3) over
+     * Z[x]/(x^N-1). The result is congruent to 1 mod p by construction.
+     */
+    template <typename Tp>
+    Poly<Tp> NTRU_GetProductPoly(NTRU_Seed<Tp> const& seed, NTRU_ProductBasis<Tp> const& basis)
+    {
+        std::vector<Tp> coeffs(seed.N,Tp{});
+        coeffs[0] = 1;
+
+        auto const poly_f12 = NTRU_MulSparse(basis.poly_f1,basis.poly_f2);
+        for (size_t i = 0; i < poly_f12.size(); ++i) coeffs[i % seed.N] += seed.p * poly_f12.coeffs()[i];
+        for (size_t i = 0; i < basis.poly_f3.size(); ++i) coeffs[i % seed.N] += seed.p * basis.poly_f3.coeffs()[i];
+
+        return Poly<Tp>{std::move(coeffs)};
+    }
+
+    template <typename Tp>
+    bool NTRU_IsValid(NTRU_ProductSeed<Tp> const& seed)
+    {
+        auto const& base = seed.seed;
+        auto const norm_f = (Tp)(1 + base.p * (Tp)(4*seed.d1*seed.d2 + 2*seed.d3));
+
+        bool valid = true;
+        valid &= base.q > 2 * ((Tp)(2*base.d) * base.p + norm_f * (base.p - 1));
+        valid &= base.N >= (size_t)(2*base.d + 1);
+        valid &= base.N >= (size_t)(2*std::max({seed.d1,seed.d2,seed.d3}));
+        return valid;
+    }
+
+    template <typename Tp>
+    bool NTRU_IsValid(NTRU_ProductSeed<Tp> const& seed, NTRU_ProductBasis<Tp> const& basis)
+    {
+        bool valid = true;
+        valid &= NTRU_IsValid(seed.seed.d,seed.seed.d,basis.poly_g);
+        valid &= NTRU_IsValid(seed.d1,seed.d1,basis.poly_f1);
+        valid &= NTRU_IsValid(seed.d2,seed.d2,basis.poly_f2);
+        valid &= NTRU_IsValid(seed.d3,seed.d3,basis.poly_f3);
+        valid &= NTRU_HasInverse(seed.seed.N,seed.seed.q,NTRU_GetProductPoly(seed.seed,basis));
+        return valid;
+    }
+
+    /*
+     * Context coefficients are reduced into [0,modulo), so the storage type
+     * only has to hold modulo-1; anything narrower would wrap silently.
+     */
+    template <typename Ts, typename Tp>
+    void NTRU_CheckStorage(Tp const& modulo)
+    {
+        if (modulo < 1 || (unsigned long long)(modulo - 1) > (unsigned long long)std::numeric_limits<Ts>::max())
+        {
+            throw std::out_of_range("NTRU_GetContext: modulus does not fit the context storage type");
+        }
+    }
+
+    /*
+     * Builds the context for a key, optionally storing its polynomial in the
+     * narrower type `Ts`; narrow contexts are convolved with NTRU_ConvolveLazy.
+     */
+
+    template <typename Ts = void, typename Tp>
+    auto NTRU_GetContext(NTRU_PubKey<Tp> const& key_pub)
+    {
+        using Storage = std::conditional_t<std::is_void_v<Ts>,Tp,Ts>;
+
+        auto const& seed = key_pub.seed;
+        NTRU_CheckStorage<Storage>(seed.q);
+
+        auto poly_ph = NTRU_Reduce(seed.N,seed.q,seed.p * key_pub.poly_h);
+        poly_ph.coeffs().resize(seed.N);
+
+        return NTRU_PubContext<Tp,Storage>{ seed, NTRU_Cast<Storage>(poly_ph) };
+    }
+
+    template <typename Ts = void, typename Tp>
+    auto NTRU_GetContext(NTRU_PrvKey<Tp> const& key_prv)
+    {
+        using Storage = std::conditional_t<std::is_void_v<Ts>,Tp,Ts>;
+
+        auto const& seed = key_prv.seed;
+        NTRU_CheckStorage<Storage>(seed.p);
+
+        auto poly_Fp = NTRU_Reduce(seed.N,seed.p,key_prv.poly_Fp);
+        poly_Fp.coeffs().resize(seed.N);
+
+        return NTRU_PrvContext<Tp,Storage>{ seed, NTRU_GetSparse(key_prv.poly_f), NTRU_Cast<Storage>(poly_Fp) };
+    }
+
 } // namespace ntru
 
 #endif // __HH_NTRU_UTIL
@@ -0,0 +1,186 @@
+
+#include "NTRU/NTRU.hh"
+
+#include <gtest/gtest.h>
+
+TEST(NTRU, ROUND_TRIP)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 4, 13, 467 };
+    ntru::NTRU_Init(0);
+
+    auto const basis = ntru::NTRU_GenBasis(seed);
+    auto const keypair = ntru::NTRU_GenKeys(seed,basis);
+    auto const message = ntru::Poly<int>{3,4,5,6,7,1,2,3};
+
+    auto const cipher = ntru::NTRU_Encrypt(keypair.key_pub,message);
+    auto const decrypt = ntru::NTRU_Decrypt(keypair.key_prv,cipher);
+    EXPECT_EQ(decrypt, message);
+}
+
+TEST(NTRU, GEN_KEYS_BATCH)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 4, 13, 467 };
+    ntru::NTRU_Init(0);
+
+    auto const keypairs = ntru::NTRU_GenKeysBatch(seed,8);
+    ASSERT_EQ(keypairs.size(), 8u);
+
+    auto const message = ntru::Poly<int>{3,4,5,6,7,1,2,3};
+
+    for (auto const& keypair : keypairs)
+    {
+        auto const& poly_f = keypair.key_prv.poly_f;
+        EXPECT_TRUE(ntru::NTRU_IsValid(seed.d+1,seed.d,poly_f));
+        EXPECT_EQ(ntru::NTRU_Reduce(seed.N,seed.p,poly_f*keypair.key_prv.poly_Fp), ntru::Poly<int>{1});
+
+        auto const cipher = ntru::NTRU_Encrypt(keypair.key_pub,message);
+        EXPECT_EQ(ntru::NTRU_Decrypt(keypair.key_prv,cipher), message);
+    }
+}
+
+TEST(NTRU, TUNE)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 4, 3, 127 };
+    ntru::NTRU_Seed<int> const other { 11, 4, 3, 467 };
+    ntru::NTRU_ClearPlans();
+
+    auto const plan = ntru::NTRU_Tune(seed,2);
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed), plan);
+    EXPECT_EQ(ntru::NTRU_GetPlan(other), ntru::NTRU_Plan{});
+
+    auto const path = testing::TempDir() + "ntrux_tune_profile";
+    ASSERT_TRUE(ntru::NTRU_SavePlans(path));
+
+    ntru::NTRU_ClearPlans();
+    ASSERT_TRUE(ntru::NTRU_Init(0,path));
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed), plan);
+    EXPECT_EQ(ntru::NTRU_GetPlan(other), ntru::NTRU_Plan{});
+
+    auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+    auto const message = ntru::Poly<int>{1,0,2,2,1,0,1};
+    EXPECT_EQ(ntru::NTRU_Decrypt(keypair.key_prv,ntru::NTRU_Encrypt(keypair.key_pub,message)), message);
+
+    ntru::NTRU_ClearPlans();
+    EXPECT_FALSE(ntru::NTRU_Init(0,testing::TempDir() + "ntrux_missing_profile"));
+}
+
+TEST(NTRU, TRACE)
+{
+    {
+        ntru::NTRU_Histogram histogram;
+        for (uint64_t value = 1; value <= 1000; ++value) histogram.record(value * 1000);
+
+        EXPECT_EQ(histogram.count(), 1000u);
+        EXPECT_EQ(histogram.max(), 1000000u);
+        EXPECT_NEAR((double)histogram.percentile(50), 500000.0, 500000.0 / 16);
+        EXPECT_NEAR((double)histogram.percentile(99), 990000.0, 990000.0 / 16);
+    }
+
+    ntru::NTRU_Seed<int> const seed { 11, 4, 13, 467 };
+    ntru::NTRU_Init(0);
+
+    ntru::NTRU_TraceReset();
+    ntru::NTRU_TraceEnable(true);
+    auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+    auto const cipher = ntru::NTRU_Encrypt(keypair.key_pub,ntru::Poly<int>{3,4,5,6,7,1,2,3});
+    ntru::NTRU_Decrypt(keypair.key_prv,cipher);
+    ntru::NTRU_TraceEnable(false);
+
+    auto const report = ntru::NTRU_TraceDump();
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::Rejection].count(), 1u);
+    EXPECT_GE(report[(size_t)ntru::NTRU_Stage::Trinomial].count(), 2u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::InverseP].count(), 1u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::InverseQ].count(), 1u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::CenterLift].count(), 1u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::Convolve].count(), 3u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::Reduce].count(), 3u);
+
+    ntru::NTRU_Decrypt(keypair.key_prv,cipher);
+    EXPECT_EQ(ntru::NTRU_TraceDump()[(size_t)ntru::NTRU_Stage::CenterLift].count(), 1u);
+}
+
+TEST(NTRU, PRODUCT_FORM)
+{
+    ntru::NTRU_ProductSeed<int> const seed { { 11, 2, 3, 467 }, 1, 1, 1 };
+    EXPECT_TRUE(ntru::NTRU_IsValid(seed));
+    ntru::NTRU_Init(0);
+
+    auto const basis = ntru::NTRU_GenBasis(seed);
+    EXPECT_TRUE(ntru::NTRU_IsValid(seed,basis));
+
+    auto const poly_f = ntru::NTRU_GetProductPoly(seed.seed,basis);
+    EXPECT_EQ(ntru::NTRU_Reduce(seed.seed.N,seed.seed.p,poly_f), ntru::Poly<int>{1});
+
+    auto const keypair = ntru::NTRU_GenKeys(seed,basis);
+    auto const message = ntru::Poly<int>{2,0,1,1,2,0,0,1,2,1};
+
+    for (int i = 0; i < 8; ++i)
+    {
+        auto const cipher = ntru::NTRU_Encrypt(keypair.key_pub,message);
+        EXPECT_EQ(ntru::NTRU_Decrypt(keypair.key_prv,cipher), message);
+    }
+}
+
+TEST(NTRU, BLIND_POOL)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 4, 13, 467 };
+    ntru::NTRU_Init(0);
+
+    auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+    auto const message = ntru::Poly<int>{3,4,5,6,7,1,2,3};
+
+    ntru::NTRU_TraceReset();
+    ntru::NTRU_TraceEnable(true);
+
+    ntru::NTRU_BlindPool<int> pool { keypair.key_pub, 8 };
+    for (int i = 0; i < 100 && pool.stats().size == 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        auto const cipher = ntru::NTRU_Encrypt(pool,message);
+        EXPECT_EQ(ntru::NTRU_Decrypt(keypair.key_prv,cipher), message);
+    }
+
+    auto const stats = pool.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 16u);
+    EXPECT_GT(stats.hits, 0u);
+
+    // background refills stay out of the request-path histograms: one reduce
+    // per pooled encrypt and two per decrypt
+    ntru::NTRU_TraceEnable(false);
+    auto const report = ntru::NTRU_TraceDump();
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::Trinomial].count(), 0u);
+    EXPECT_EQ(report[(size_t)ntru::NTRU_Stage::Reduce].count(), 16u + 2*16u);
+}
+
+TEST(NTRU, BLIND_POOL_TARGET)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 4, 13, 467 };
+    ntru::NTRU_Init(0);
+
+    auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+
+    ntru::NTRU_BlindPool<int> pool { keypair.key_pub, 64 };
+    auto const initial = pool.stats().target;
+    ASSERT_EQ(initial, 16u);
+
+    // a burst that outruns the worker finds the ring empty and doubles the target
+    for (int i = 0; i < 100000 && pool.stats().misses == 0; ++i) pool.blind();
+    ASSERT_GT(pool.stats().misses, 0u);
+
+    auto const grown = pool.stats().target;
+    EXPECT_GE(grown, 2*initial);
+    EXPECT_LE(grown, 64u);
+
+    // with no blinds taken, every idle period trims the target by an eighth
+    for (int i = 0; i < 50 && pool.stats().target == grown; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    auto const decayed = pool.stats().target;
+    EXPECT_LT(decayed, grown);
+    EXPECT_GE(decayed, grown - grown / 8);
+}
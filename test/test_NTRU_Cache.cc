@@ -0,0 +1,135 @@
+
+#include "NTRU/NTRU.hh"
+#include "NTRU/NTRU_Cache.hh"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(NTRU_CACHE, SPARSE_CONVOLVE)
+{
+    auto const poly_a = ntru::Poly<int>{1,0,-1,1,0,-1,0};
+    auto const poly_b = ntru::Poly<int>{3,1,4,1,5,9,2};
+    {
+        auto const result = ntru::NTRU_SparseConvolve(7,11,ntru::NTRU_GetSparse(poly_a),poly_b);
+        auto const expected = ntru::NTRU_Reduce(7,11,poly_a*poly_b);
+        EXPECT_EQ(result, expected);
+    }
+}
+
+TEST(NTRU_CACHE, CONTEXT)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 2, 3, 41 };
+
+    ntru::NTRU_Init(0);
+    auto const basis = ntru::NTRU_GenBasis(seed);
+    auto const keypair = ntru::NTRU_GenKeys(seed,basis);
+    auto const message = ntru::Poly<int>{1,0,2,2,1,0,1,0,0,1,2};
+
+    ntru::NTRU_Init(1);
+    auto const cipher = ntru::NTRU_Encrypt(keypair.key_pub,message);
+    ntru::NTRU_Init(1);
+    auto const cipher_context = ntru::NTRU_Encrypt(ntru::NTRU_GetContext(keypair.key_pub),message);
+    EXPECT_EQ(cipher_context, cipher);
+
+    auto const decrypt = ntru::NTRU_Decrypt(keypair.key_prv,cipher);
+    auto const decrypt_context = ntru::NTRU_Decrypt(ntru::NTRU_GetContext(keypair.key_prv),cipher);
+    EXPECT_EQ(decrypt_context, decrypt);
+
+    ntru::NTRU_Init(1);
+    auto const cipher_narrow = ntru::NTRU_Encrypt(ntru::NTRU_GetContext<uint16_t>(keypair.key_pub),message);
+    EXPECT_EQ(cipher_narrow, cipher);
+
+    auto const decrypt_narrow = ntru::NTRU_Decrypt(ntru::NTRU_GetContext<int8_t>(keypair.key_prv),cipher);
+    EXPECT_EQ(decrypt_narrow, decrypt);
+
+    ntru::NTRU_PubCache<int,uint16_t> cache { 1 << 20, 1 };
+    EXPECT_EQ(cache.get(keypair.key_pub)->poly_ph, ntru::NTRU_GetContext<uint16_t>(keypair.key_pub).poly_ph);
+
+    ntru::NTRU_PubKey<int> const key_wide { { 11, 2, 3, 65536 }, { 40000,3,65000,17,0,1234,9,60001,5,42,31337 } };
+    ntru::NTRU_Init(1);
+    auto const cipher_wide = ntru::NTRU_Encrypt(ntru::NTRU_GetContext(key_wide),message);
+    ntru::NTRU_Init(1);
+    EXPECT_EQ(ntru::NTRU_Encrypt(ntru::NTRU_GetContext<uint16_t>(key_wide),message), cipher_wide);
+
+    ntru::NTRU_PubKey<int> const key_overflow { { 11, 2, 3, 65537 }, key_wide.poly_h };
+    EXPECT_THROW(ntru::NTRU_GetContext<uint16_t>(key_overflow), std::out_of_range);
+    EXPECT_THROW(ntru::NTRU_GetContext<int8_t>(key_wide), std::out_of_range);
+}
+
+TEST(NTRU_CACHE, LOOKUP)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 2, 3, 41 };
+    ntru::NTRU_PubCache<int> cache { 1 << 20, 4 };
+
+    ntru::NTRU_Init(0);
+    auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+
+    auto const context1 = cache.get(keypair.key_pub);
+    auto const context2 = cache.get(keypair.key_pub);
+    EXPECT_EQ(context1, context2);
+    EXPECT_EQ(context1->poly_ph, ntru::NTRU_GetContext(keypair.key_pub).poly_ph);
+
+    auto const stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+
+    // a key padded with zeros hits the same entry without touching it
+    auto key_padded = keypair.key_pub;
+    key_padded.poly_h.coeffs().resize(key_padded.poly_h.size() + 2);
+    auto const size = context1->poly_ph.size();
+
+    EXPECT_EQ(cache.get(key_padded), context1);
+    EXPECT_EQ(cache.stats().hits, 2u);
+    EXPECT_EQ(context1->poly_ph.size(), size);
+}
+
+TEST(NTRU_CACHE, EVICTION)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 2, 3, 41 };
+    ntru::NTRU_PubCache<int> cache { 1024, 1 };
+
+    ntru::NTRU_Init(0);
+    for (int i = 0; i < 16; ++i)
+    {
+        auto const keypair = ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed));
+        cache.get(keypair.key_pub);
+    }
+
+    auto const stats = cache.stats();
+    EXPECT_EQ(stats.misses, 16u);
+    EXPECT_GT(stats.evictions, 0u);
+    EXPECT_LE(stats.bytes, 1024u);
+    EXPECT_EQ(stats.entries + stats.evictions, 16u);
+}
+
+TEST(NTRU_CACHE, CONCURRENT)
+{
+    ntru::NTRU_Seed<int> const seed { 11, 2, 3, 41 };
+    ntru::NTRU_PubCache<int> cache { 2048, 2 };
+
+    ntru::NTRU_Init(0);
+    std::vector<ntru::NTRU_PubKey<int>> keys;
+    for (int i = 0; i < 8; ++i) keys.push_back(ntru::NTRU_GenKeys(seed,ntru::NTRU_GenBasis(seed)).key_pub);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cache,&keys,t]()
+        {
+            for (size_t i = 0; i < 256; ++i)
+            {
+                auto const& key = keys[(i * (t+1)) % keys.size()];
+                EXPECT_EQ(cache.get(key)->poly_ph, ntru::NTRU_GetContext(key).poly_ph);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto const stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 4u * 256u);
+    EXPECT_LE(stats.bytes, 2048u);
+}
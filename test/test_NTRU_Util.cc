@@ -3,6 +3,11 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
 TEST(NTRU_UTIL, REDUCE)
 {
     ntru::Poly<int> const poly { 2, 3, 5, 7, 11, 13, 17 };
@@ -16,6 +21,13 @@ TEST(NTRU_UTIL, REDUCE)
         auto const expected = ntru::Poly<int>{ 1, 4, 3 };
         EXPECT_EQ(result, expected);
     }
+    {
+        auto constexpr max = std::numeric_limits<long>::max();
+        auto constexpr min = std::numeric_limits<long>::min();
+        auto const result = ntru::NTRU_Reduce(2,7L,ntru::Poly<long>{ max, min, max, min, 3 });
+        auto const expected = ntru::Poly<long>{ (2*(max%7)+3) % 7, (2*(min%7)%7+7) % 7 };
+        EXPECT_EQ(result, expected);
+    }
 }
 
 TEST(NTRU_UTIL, CENTER_LIFT)
@@ -92,3 +104,181 @@ TEST(NTRU_UTIL, INVERSE)
         }
     }
 }
+
+TEST(NTRU_UTIL, MULTIPLY_KERNELS)
+{
+    auto const poly_a = ntru::Poly<int>{3,-1,4,1,-5,9,2,-6,5,3,-5,8,9};
+    auto const poly_b = ntru::Poly<int>{0,1,0,-1,1,0,0,-1,0};
+    auto const expected = poly_a * poly_b;
+
+    EXPECT_EQ(ntru::NTRU_MulSparse(poly_a,poly_b), expected);
+    EXPECT_EQ(ntru::NTRU_MulSparse(poly_b,poly_a), expected);
+
+    for (size_t cutoff = 1; cutoff < 16; ++cutoff)
+    {
+        EXPECT_EQ(ntru::NTRU_MulKaratsuba(poly_a,poly_b,cutoff), expected);
+    }
+
+    EXPECT_EQ(ntru::NTRU_ReduceFold(5,7,expected), ntru::NTRU_Reduce(5,7,expected));
+}
+
+TEST(NTRU_UTIL, PLAN_PROFILE)
+{
+    ntru::NTRU_Seed<int> const seed_a { 11, 4, 5, 467 };
+    ntru::NTRU_Seed<int> const seed_b { 11, 3, 5, 467 };
+    ntru::NTRU_Seed<int> const seed_c { 7, 2, 3, 41 };
+
+    ntru::NTRU_ClearPlans();
+    ntru::NTRU_SetPlan(seed_a,{ ntru::NTRU_MulKernel::Karatsuba, ntru::NTRU_ReduceKernel::Fold, 4, 64 });
+    ntru::NTRU_SetPlan(seed_c,{ ntru::NTRU_MulKernel::Sparse, ntru::NTRU_ReduceKernel::Eager, 32 });
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed_b), ntru::NTRU_Plan{});
+
+    auto const path = testing::TempDir() + "ntrux_plan_profile";
+    EXPECT_TRUE(ntru::NTRU_SavePlans(path));
+
+    ntru::NTRU_ClearPlans();
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed_a).mul, ntru::NTRU_MulKernel::Schoolbook);
+    EXPECT_TRUE(ntru::NTRU_LoadPlans(path));
+
+    auto const plan = ntru::NTRU_GetPlan(seed_a);
+    EXPECT_EQ(plan.mul, ntru::NTRU_MulKernel::Karatsuba);
+    EXPECT_EQ(plan.reduce, ntru::NTRU_ReduceKernel::Fold);
+    EXPECT_EQ(plan.cutoff, 4u);
+    EXPECT_EQ(plan.grain, 64u);
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed_b), ntru::NTRU_Plan{});
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed_c).grain, ntru::NTRU_Plan{}.grain);
+    EXPECT_EQ(ntru::NTRU_GetPlan(seed_c).mul, ntru::NTRU_MulKernel::Sparse);
+
+    auto const poly_a = ntru::Poly<int>{1,4,2,0,3,1,1,2,4,0,3};
+    auto const poly_b = ntru::Poly<int>{1,0,-1,0,1,-1,0,0,1,0,-1};
+    EXPECT_EQ(ntru::NTRU_Convolve(plan,11,5,poly_a,poly_b), ntru::NTRU_Reduce(11,5,poly_a*poly_b));
+
+    {
+        std::ofstream file{path};
+        file << "11 4 5 467 karatsuba fold 4" << "\n";
+    }
+    EXPECT_FALSE(ntru::NTRU_LoadPlans(path));
+
+    ntru::NTRU_ClearPlans();
+}
+
+TEST(NTRU_UTIL, CONVOLVE_MIXED_WIDTH)
+{
+    auto const poly_a = ntru::Poly<int>{40000,3,65000,17,0,1234,9,60001,5,42,31337};
+    auto const poly_b = ntru::Poly<int>{1,0,-1,0,1,-1,0,0,1,0,-1,1,-1};
+    auto const expected = ntru::NTRU_Reduce(11,65521,poly_a*poly_b);
+    {
+        auto const result = ntru::NTRU_ConvolveLazy(11,65521,poly_a,poly_b);
+        EXPECT_EQ(result, expected);
+    }
+    {
+        auto const narrow_a = ntru::NTRU_Cast<uint16_t>(poly_a);
+        auto const narrow_b = ntru::NTRU_Cast<int8_t>(poly_b);
+        auto const result = ntru::NTRU_ConvolveLazy<uint16_t>(11,65521,narrow_a,narrow_b);
+        EXPECT_EQ(ntru::NTRU_Cast<int>(result), expected);
+    }
+    {
+        auto const narrow_a = ntru::NTRU_Cast<int8_t>(poly_b);
+        auto const result = ntru::NTRU_ConvolveLazy<int8_t>(11,3,narrow_a,narrow_a);
+        EXPECT_EQ(ntru::NTRU_Cast<int>(result), ntru::NTRU_Reduce(11,3,poly_b*poly_b));
+    }
+    {
+        auto const narrow_a = ntru::NTRU_Cast<uint16_t>(poly_a);
+        auto const narrow_b = ntru::NTRU_Cast<int8_t>(poly_b);
+        auto const result = ntru::NTRU_ConvolveLazy<uint16_t>(11,65536,narrow_a,narrow_b);
+        EXPECT_EQ(ntru::NTRU_Cast<int>(result), ntru::NTRU_Reduce(11,65536,poly_a*poly_b));
+    }
+}
+
+TEST(NTRU_UTIL, INVERSE_BATCH)
+{
+    std::vector<ntru::Poly<int>> polys;
+    for (int a = 0; a < 11; a += 2) for (int b = 0; b < 11; b += 3) for (int c = 0; c < 11; c += 5)
+    {
+        polys.push_back(ntru::Poly<int>{a,b,c,1,a+b});
+    }
+
+    auto const inverses = ntru::NTRU_GetInverseBatch(5,11,polys);
+    ASSERT_EQ(inverses.size(), polys.size());
+
+    for (size_t i = 0; i < polys.size(); ++i)
+    {
+        if (ntru::NTRU_HasInverse(5,11,polys[i]))
+        {
+            EXPECT_EQ(inverses[i], ntru::NTRU_GetInverse(5,11,polys[i]));
+            EXPECT_EQ(ntru::NTRU_Reduce(5,11,polys[i]*inverses[i]), ntru::Poly<int>{1});
+        } else {
+            EXPECT_EQ(inverses[i].size(), 0u);
+        }
+    }
+}
+
+TEST(NTRU_UTIL, INVERSE_BATCH_WIDE)
+{
+    // N*q^2 exceeds 2^31, so tree products must not accumulate in int
+    srand(0);
+    std::vector<ntru::Poly<int>> polys;
+    for (int i = 0; i < 4; ++i) polys.push_back(ntru::NTRU_GenTrinomial<int>(401,60,59));
+
+    auto const inverses = ntru::NTRU_GetInverseBatch(401,8191,polys);
+    ASSERT_EQ(inverses.size(), polys.size());
+
+    for (size_t i = 0; i < polys.size(); ++i)
+    {
+        EXPECT_EQ(inverses[i], ntru::NTRU_GetInverse(401,8191,polys[i]));
+        if (inverses[i].size() == 0) continue;
+        EXPECT_EQ(ntru::NTRU_Reduce(401,8191,polys[i]*inverses[i]), ntru::Poly<int>{1});
+    }
+
+    for (auto const& plan : {
+        ntru::NTRU_Plan{ ntru::NTRU_MulKernel::Karatsuba, ntru::NTRU_ReduceKernel::Fold, 16 },
+        ntru::NTRU_Plan{ ntru::NTRU_MulKernel::Parallel, ntru::NTRU_ReduceKernel::Eager, 8, 32 } })
+    {
+        EXPECT_EQ(ntru::NTRU_GetInverseBatch(plan,401,8191,polys), inverses);
+        EXPECT_EQ(ntru::NTRU_GetInverse(plan,401,8191,polys[0]), inverses[0]);
+    }
+}
+
+TEST(NTRU_UTIL, MULTIPLY_PARALLEL)
+{
+    std::vector<int> coeffs_a(1021), coeffs_b(1021);
+    for (size_t i = 0; i < coeffs_a.size(); ++i)
+    {
+        coeffs_a[i] = (int)((i * 7919) % 2053);
+        coeffs_b[i] = (int)((i * 31) % 3) - 1;
+    }
+    auto const poly_a = ntru::Poly<int>{coeffs_a};
+    auto const poly_b = ntru::Poly<int>{coeffs_b};
+    auto const expected = ntru::NTRU_MulKaratsuba(poly_a,poly_b,32);
+
+    EXPECT_EQ(ntru::NTRU_MulParallel(poly_a,poly_b,8,16), expected);
+    EXPECT_EQ(ntru::NTRU_MulParallel(poly_a,poly_b,32,256), expected);
+
+    ntru::NTRU_Plan const plan { ntru::NTRU_MulKernel::Parallel, ntru::NTRU_ReduceKernel::Eager, 8, 64 };
+    EXPECT_EQ(ntru::NTRU_Multiply(plan,poly_a,poly_b), ntru::NTRU_Cast<int64_t>(expected));
+
+    // Dense operands mod q sum past 2^31, so the kernels must accumulate wide
+    auto const poly_c = ntru::Poly<int>{std::vector<int>(1021,8190)};
+    auto const expected_wide = ntru::NTRU_Reduce(ntru::NTRU_Plan{},1021,8191,ntru::NTRU_Multiply(ntru::NTRU_Plan{},poly_c,poly_c));
+    EXPECT_EQ(expected_wide, ntru::Poly<int>{std::vector<int>(1021,1021 % 8191)});
+    EXPECT_EQ(ntru::NTRU_Convolve(plan,1021,8191,poly_c,poly_c), expected_wide);
+}
+
+TEST(NTRU_UTIL, TASK_GROUP)
+{
+    ntru::NTRU_ThreadPool pool { 2 };
+    std::atomic<int> count { 0 };
+
+    ntru::NTRU_TaskGroup group { pool };
+    for (int i = 0; i < 8; ++i)
+    {
+        group.run([&count,i]()
+        {
+            count.fetch_add(1);
+            if (i == 3) throw std::runtime_error{"task"};
+        });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(count.load(), 8);
+    EXPECT_NO_THROW(group.wait());
+}